@@ -0,0 +1,14 @@
+import json
+import time
+import dtest
+
+num_tests = 10000
+dtest.cluster(name="x",size=2)
+dtest.add_process([0,1], ["hostname"])
+t0 = time.perf_counter()
+for i in range(num_tests):
+    dtest.add_test('test %d' % i, lambda lines: None)
+t1 = time.perf_counter()
+print(json.dumps({"benchmark": "python/add_test", "parameters": {"tests": num_tests},
+                  "value": (t1-t0)/num_tests, "unit": "s"}), flush=True)
+dtest.run()
@@ -0,0 +1,49 @@
+#ifndef DTEST_BENCH_BENCH_HH
+#define DTEST_BENCH_BENCH_HH
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace dts {
+
+    namespace bench {
+
+        using clock_type = std::chrono::steady_clock;
+        using seconds = std::chrono::duration<double>;
+
+        /// Print one result as a single JSON object per line, so that the output of
+        /// all benchmarks can be concatenated and compared between releases.
+        inline void
+        report(const std::string& name, const std::string& parameters,
+               double value, const char* unit) {
+            std::cout << "{\"benchmark\":\"" << name << "\","
+                << "\"parameters\":{" << parameters << "},"
+                << "\"value\":" << value << ","
+                << "\"unit\":\"" << unit << "\"}" << std::endl;
+        }
+
+        template <class T>
+        inline std::string
+        parameter(const char* name, const T& value) {
+            std::stringstream tmp;
+            tmp << '"' << name << "\":" << value;
+            return tmp.str();
+        }
+
+        inline size_t
+        to_size(const char* s) {
+            std::stringstream tmp(s);
+            size_t n = 0;
+            if (!(tmp >> n)) { throw std::invalid_argument(s); }
+            return n;
+        }
+
+    }
+
+}
+
+#endif // vim:filetype=cpp
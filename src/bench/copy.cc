@@ -0,0 +1,51 @@
+#include <fcntl.h>
+#include <poll.h>
+
+#include <iostream>
+#include <thread>
+
+#include <unistdx/io/pipe>
+
+#include <bench/bench.hh>
+#include <dtest/application.hh>
+
+int main(int argc, char* argv[]) {
+    using namespace dts::bench;
+    if (argc != 3) {
+        std::cerr << "usage: dtest-bench-copy num-lines line-size\n";
+        return 1;
+    }
+    const auto num_lines = to_size(argv[1]);
+    const auto line_size = to_size(argv[2]);
+    sys::pipe pipe;
+    pipe.out().unsetf(sys::open_flag::non_blocking);
+    sys::fildes null(::open("/dev/null", O_WRONLY | O_CLOEXEC));
+    dts::process_output output("x1: ", std::move(pipe.in()), null.fd());
+    std::thread writer([&pipe,num_lines,line_size] () {
+        std::string line(line_size, 'x');
+        line += '\n';
+        std::string chunk;
+        while (chunk.size() < 65536) { chunk += line; }
+        const size_t lines_per_chunk = chunk.size() / line.size();
+        for (size_t i=0; i<num_lines; i += lines_per_chunk) {
+            const auto n = std::min(lines_per_chunk, num_lines-i);
+            pipe.out().write(chunk.data(), n*line.size());
+        }
+        pipe.out().close();
+    });
+    dts::line_array lines;
+    lines.reserve(num_lines);
+    ::pollfd fds{output.in().fd(), POLLIN, 0};
+    const auto t0 = clock_type::now();
+    while (lines.size() != num_lines) {
+        if (::poll(&fds, 1, -1) == -1) { break; }
+        output.copy(lines, 0);
+    }
+    const auto t1 = clock_type::now();
+    writer.join();
+    const auto dt = std::chrono::duration_cast<seconds>(t1-t0).count();
+    const auto params = parameter("lines", num_lines) + "," + parameter("line_size", line_size);
+    report("process_output/copy/lines", params, num_lines/dt, "lines/s");
+    report("process_output/copy/bytes", params, num_lines*(line_size+1)/dt, "B/s");
+    return 0;
+}
@@ -0,0 +1,50 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <bench/bench.hh>
+
+void usage() {
+    std::cout << "usage: dtest-emit [-h] [--help] [--lines n] [--size n] [--rate n] [--marker]\n"
+        "--lines n    the number of lines to print (default is 1000)\n"
+        "--size n     line size in bytes without newline character (default is 100)\n"
+        "--rate n     lines per second, zero means as fast as possible (default is 0)\n"
+        "--marker     print \"done\" line after all lines\n";
+}
+
+int main(int argc, char* argv[]) {
+    using namespace dts::bench;
+    size_t num_lines = 1000, line_size = 100, rate = 0;
+    bool marker = false;
+    try {
+        for (int i=1; i<argc; ++i) {
+            std::string arg(argv[i]);
+            if (arg == "--help" || arg == "-h") { usage(); return 0; }
+            else if (arg == "--lines" && i+1 != argc) { num_lines = to_size(argv[++i]); }
+            else if (arg == "--size" && i+1 != argc) { line_size = to_size(argv[++i]); }
+            else if (arg == "--rate" && i+1 != argc) { rate = to_size(argv[++i]); }
+            else if (arg == "--marker") { marker = true; }
+            else { usage(); return 1; }
+        }
+    } catch (const std::exception&) {
+        usage();
+        return 1;
+    }
+    std::string line(line_size, 'x');
+    line += '\n';
+    const auto period = rate == 0 ? clock_type::duration::zero()
+        : std::chrono::duration_cast<clock_type::duration>(seconds(1.0/rate));
+    auto next = clock_type::now();
+    for (size_t i=0; i<num_lines; ++i) {
+        std::cout.write(line.data(), line.size());
+        if (rate != 0) {
+            std::cout.flush();
+            next += period;
+            std::this_thread::sleep_until(next);
+        }
+    }
+    if (marker) { std::cout << "done\n"; }
+    std::cout.flush();
+    return 0;
+}
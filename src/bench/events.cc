@@ -0,0 +1,72 @@
+#include <poll.h>
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <unistdx/io/pipe>
+
+#include <bench/bench.hh>
+#include <dtest/event.hh>
+#include <dtest/event_output.hh>
+#include <dtest/event_ring.hh>
+
+namespace {
+
+    template <class Writer, class Reader>
+    double measure(size_t num_events, Writer write, Reader read, int fd) {
+        using namespace dts::bench;
+        dts::event_array events;
+        events.reserve(num_events);
+        std::thread writer(write);
+        ::pollfd fds{fd, POLLIN, 0};
+        const auto t0 = clock_type::now();
+        while (events.size() < num_events) {
+            if (::poll(&fds, 1, 100) == -1) { break; }
+            read(events);
+        }
+        const auto t1 = clock_type::now();
+        writer.join();
+        return std::chrono::duration_cast<seconds>(t1-t0).count();
+    }
+
+}
+
+int main(int argc, char* argv[]) {
+    using namespace dts::bench;
+    if (argc != 4 || (std::strcmp(argv[3], "pipe") != 0 && std::strcmp(argv[3], "ring") != 0)) {
+        std::cerr << "usage: dtest-bench-events num-events payload-size pipe|ring\n";
+        return 1;
+    }
+    const auto num_events = to_size(argv[1]);
+    const auto payload_size = to_size(argv[2]);
+    const std::string mode = argv[3];
+    const std::string payload(payload_size, 'x');
+    double dt = 0;
+    if (mode == "pipe") {
+        sys::pipe pipe;
+        pipe.out().unsetf(sys::open_flag::non_blocking);
+        const int out = pipe.out().fd();
+        dts::event_output output(std::move(pipe.in()), 0);
+        dt = measure(num_events, [&] () {
+            for (size_t i=0; i<num_events; ++i) {
+                dts::events::write(out, i, payload.data(), payload.size());
+            }
+        }, [&] (dts::event_array& events) { output.copy(events); }, output.in().fd());
+    } else {
+        dts::event_ring ring(1024*1024, 0);
+        dts::events::ring_writer writer(ring.header(), ring.in().fd());
+        dt = measure(num_events, [&] () {
+            for (size_t i=0; i<num_events; ) {
+                // the benchmark measures throughput, hence retry instead of dropping
+                if (writer.write(i, payload.data(), payload.size())) { ++i; }
+                else { std::this_thread::yield(); }
+            }
+        }, [&] (dts::event_array& events) { ring.copy(events); }, ring.in().fd());
+    }
+    const auto params = parameter("events", num_events) + "," +
+        parameter("payload_size", payload_size) + ",\"mode\":\"" + mode + "\"";
+    report("events/" + mode, params, num_events/dt, "events/s");
+    return 0;
+}
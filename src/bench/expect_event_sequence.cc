@@ -0,0 +1,34 @@
+#include <iostream>
+
+#include <bench/bench.hh>
+#include <dtest/application.hh>
+
+int main(int argc, char* argv[]) {
+    using namespace dts::bench;
+    if (argc != 2) {
+        std::cerr << "usage: dtest-bench-expect-event-sequence num-lines\n";
+        return 1;
+    }
+    const auto num_lines = to_size(argv[1]);
+    dts::string_array lines;
+    lines.reserve(num_lines);
+    for (size_t i=0; i<num_lines; ++i) {
+        std::stringstream tmp;
+        tmp << 'x' << (i%16+1) << ": line " << i;
+        lines.emplace_back(tmp.str());
+    }
+    // the worst case: all events are at the very end of the output
+    lines.emplace_back("x1: leader elected");
+    lines.emplace_back("x2: joined x1");
+    dts::string_array events{"^x1: leader elected$", "^x2: joined x1$"};
+    size_t num_repetitions = std::max(size_t(1), size_t(1000000)/(num_lines+1));
+    const auto t0 = clock_type::now();
+    for (size_t i=0; i<num_repetitions; ++i) {
+        dts::expect_event_sequence(lines, events);
+    }
+    const auto t1 = clock_type::now();
+    const auto dt = std::chrono::duration_cast<seconds>(t1-t0).count();
+    report("expect_event_sequence", parameter("lines", lines.size()),
+           dt/num_repetitions, "s");
+    return 0;
+}
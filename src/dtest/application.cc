@@ -1,7 +1,26 @@
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/ioctl.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
+#include <memory>
 #include <regex>
 #include <sstream>
 #include <string>
+#include <system_error>
+#include <unordered_map>
 
 #include <unistdx/base/command_line>
 #include <unistdx/io/two_way_pipe>
@@ -16,6 +35,132 @@
 #include <dtest/application.hh>
 
 namespace  {
+
+    /// Accumulates forwarded output in the string instead of writing it.
+    class string_sink {
+    private:
+        std::string& _string;
+    public:
+        inline explicit string_sink(std::string& s): _string(s) {}
+        inline ssize_t write(const void* data, size_t n) {
+            this->_string.append(static_cast<const char*>(data), n);
+            return n;
+        }
+    };
+
+    void forward_all(sys::fd_type& out, const std::string& s) {
+        auto first = s.data();
+        auto n = s.size();
+        while (n != 0) {
+            auto m = out.write(first, n);
+            if (m <= 0) { break; }
+            first += m, n -= m;
+        }
+    }
+
+    /**
+    \brief Environment of the child process that is built before fork.
+    \details The child of multithreaded process may call only async-signal-safe
+    functions until it executes the command, hence the variables are formatted
+    in the parent and the child only replaces the pointer to the environment.
+    */
+    class child_environment {
+
+    private:
+        dts::string_array _variables;
+        std::vector<char*> _pointers;
+
+    public:
+        inline child_environment() {
+            for (char** first=::environ; *first; ++first) { this->_variables.emplace_back(*first); }
+            update();
+        }
+
+        void set(const std::string& name, const std::string& value) {
+            auto variable = name + '=' + value;
+            auto result = std::find_if(
+                this->_variables.begin(), this->_variables.end(),
+                [&name] (const std::string& v) {
+                    return v.size() > name.size() && v[name.size()] == '=' &&
+                        v.compare(0, name.size(), name) == 0;
+                });
+            if (result == this->_variables.end()) {
+                this->_variables.emplace_back(std::move(variable));
+            } else {
+                *result = std::move(variable);
+            }
+            update();
+        }
+
+        /// Called in the child process.
+        inline void apply() noexcept { ::environ = this->_pointers.data(); }
+
+    private:
+        void update() {
+            this->_pointers.clear();
+            for (auto& v : this->_variables) { this->_pointers.emplace_back(&v[0]); }
+            this->_pointers.emplace_back(nullptr);
+        }
+
+    };
+
+    template <class T> inline std::string format(const T& value) {
+        std::stringstream tmp;
+        tmp << value;
+        return tmp.str();
+    }
+
+    /// Pass the write end of the event channel to the child process.
+    void set_event_channel(sys::pipe& events) {
+        events.in().close();
+        // fcntl(2) is async-signal-safe, unlike dup(2) followed by setenv(3)
+        if (::fcntl(events.out().fd(), F_SETFD, 0) == -1) {
+            throw std::system_error(errno, std::generic_category());
+        }
+    }
+
+    /// Create new mount namespace for the calling process and mount tmpfs
+    /// of at most \p size bytes at \p path (that has to exist) in it.
+    void unshare_tmpfs(const std::string& path, size_t size) {
+        if (::unshare(CLONE_NEWNS) == -1) {
+            throw std::system_error(errno, std::generic_category());
+        }
+        // do not propagate node's mounts to the parent namespace
+        if (::mount("none", "/", nullptr, MS_REC | MS_PRIVATE, nullptr) == -1) {
+            throw std::system_error(errno, std::generic_category());
+        }
+        std::string options = "mode=1777";
+        if (size != 0) { options += ",size=" + std::to_string(size); }
+        if (::mount("tmpfs", path.data(), "tmpfs", MS_NOSUID | MS_NODEV,
+                    options.data()) == -1) {
+            throw std::system_error(errno, std::generic_category());
+        }
+    }
+
+    /// Enter node's mount namespace (if any) preserving working directory.
+    void enter_mount_namespace(const sys::fildes& ns) {
+        if (!ns) { return; }
+        char cwd[PATH_MAX];
+        if (!::getcwd(cwd, sizeof(cwd))) {
+            throw std::system_error(errno, std::generic_category());
+        }
+        // setns(2) changes working directory to the root directory
+        sys::this_process::enter(ns.fd());
+        // the working directory is hidden when it is under the tmpfs mount point,
+        // hence the process starts in the root directory in that case
+        if (::chdir(cwd) == -1 && ::chdir("/") == -1) {
+            throw std::system_error(errno, std::generic_category());
+        }
+    }
+
+    /// Block until the parent writes to the pipe or closes it.
+    void wait_for_parent(sys::pipe* gate) {
+        if (!gate) { return; }
+        gate->out().close();
+        char ch;
+        gate->in().read(&ch, 1);
+    }
+
     void print_stack_trace() {
         if (auto ptr = std::current_exception()) {
             try {
@@ -33,10 +178,17 @@ namespace  {
     }
 }
 
+constexpr const size_t dts::process_output::max_buffer_size;
+
 void dts::application::usage() {
     std::cout <<
         "usage: dtest [-h] [--help] [--exit-code code] [--restart] [--name name] [--size n]\n"
-        "      [--network ip/prefix] [--peer-network ip/prefix]\n"
+        "      [--network ip/prefix] [--peer-network ip/prefix] [--metrics] [--stats file]\n"
+        "      [--record file] [--replay file] [--max-memory n] [--retain regex]\n"
+        "      [--event-ring n] [--event-watermark n] [--zero-copy]\n"
+        "      [--max-line-length n] [--pipe-size n] [--readers n] [--test-threads n]\n"
+        "      [--timeout seconds] [--tmpfs path] [--tmpfs-size n] [--perf-counters]\n"
+        "      [--capture file] [--traffic]\n"
         "      [--exec where command argument1...]\n"
         "--exit-code code      how exit code of child processes is accumulated,\n"
         "                      possible values: all, master, process no. starting from 1\n"
@@ -46,6 +198,33 @@ void dts::application::usage() {
         "--network ip/n        subnetwork veth (default is 10.1.0.0/16)\n"
         "--peer-network ip/n   subnetwork veth peers (default is 10.0.0.0/16),\n"
         "                      this is the network where applications are executed\n"
+        "--metrics             print dtest self-metrics when the tests finish\n"
+        "--stats file          periodically write dtest self-metrics to the file\n"
+        "--record file         write captured output to the file (compressed if it ends with .gz)\n"
+        "--replay file         run the tests against the recorded output\n"
+        "                      without launching any processes\n"
+        "--max-memory n        keep at most n megabytes of captured lines in memory,\n"
+        "                      move older lines to temporary file\n"
+        "--retain regex        move to temporary file only the lines that match regex\n"
+        "--max-line-length n   truncate captured lines longer than n bytes (default is 1MiB)\n"
+        "--pipe-size n         set capacity of child process output pipes to n bytes\n"
+        "--timeout seconds     fail the tests and terminate the processes if the tests\n"
+        "                      do not succeed in the specified number of seconds\n"
+        "--test-threads n      evaluate independent tests concurrently in n threads\n"
+        "--readers n           read output of child processes in n threads\n"
+        "--zero-copy           forward output of child processes with splice(2) instead\n"
+        "                      of write(2) (lines are not prefixed with node names)\n"
+        "--event-ring n        pass binary events via n kilobytes shared memory ring\n"
+        "                      instead of the pipe\n"
+        "--event-watermark n   wake up dtest when the ring contains at least n bytes\n"
+        "--tmpfs path          mount private tmpfs at the path on every node\n"
+        "                      (the directory is created if it does not exist)\n"
+        "--tmpfs-size n        limit the size of each node's tmpfs to n megabytes\n"
+        "--perf-counters       count cycles, instructions, cache misses and context\n"
+        "                      switches of every process and report them per node\n"
+        "--capture file        write the frames that pass through the cluster bridge\n"
+        "                      to pcapng file (implies --traffic)\n"
+        "--traffic             report the number of frames and bytes per node\n"
         "--exec where args...  execute application on a set of nodes,\n"
         "                      \"where\" is a comma-separated list of node numbers\n"
         "                      starting from 1 (e.g. 1,2,4) or \"*\",\n"
@@ -56,8 +235,9 @@ void dts::application::usage() {
 void dts::application::init(int argc, char* argv[]) {
     this->_argv = argv;
     size_t cluster_size = 1;
-    cluster_node::address_type cluster_network{{10,1,0,1},16};
-    cluster_node::address_type cluster_peer_network{{10,0,0,1},16};
+    this->_cluster.read_environment();
+    auto cluster_network = this->_cluster.network();
+    auto cluster_peer_network = this->_cluster.peer_network();
     bool inside_exec = false;
     bool exec_first_arg = false;
     for (int i=1; i<argc; ++i) {
@@ -108,6 +288,91 @@ void dts::application::init(int argc, char* argv[]) {
             this->_execution_delay = std::chrono::milliseconds(ms);
         } else if (arg == "--restart") {
             this->_will_restart = true;
+        } else if (arg == "--metrics") {
+            this->_print_metrics = true;
+        } else if (arg == "--stats") {
+            if (i+1 == argc) { throw std::invalid_argument("bad --stats"); }
+            this->_stats_file = argv[++i];
+        } else if (arg == "--max-memory") {
+            if (i+1 == argc) { throw std::invalid_argument("bad --max-memory"); }
+            size_t megabytes = 0;
+            std::stringstream tmp(argv[++i]);
+            tmp >> megabytes;
+            if (!tmp) { throw std::invalid_argument("bad --max-memory"); }
+            this->_lines.max_memory(megabytes*1024UL*1024UL);
+        } else if (arg == "--retain") {
+            if (i+1 == argc) { throw std::invalid_argument("bad --retain"); }
+            this->_lines.filter(argv[++i]);
+        } else if (arg == "--max-line-length") {
+            if (i+1 == argc) { throw std::invalid_argument("bad --max-line-length"); }
+            std::stringstream tmp(argv[++i]);
+            tmp >> this->_max_line_length;
+            if (!tmp || this->_max_line_length == 0) {
+                throw std::invalid_argument("bad --max-line-length");
+            }
+        } else if (arg == "--pipe-size") {
+            if (i+1 == argc) { throw std::invalid_argument("bad --pipe-size"); }
+            std::stringstream tmp(argv[++i]);
+            tmp >> this->_pipe_size;
+            if (!tmp || this->_pipe_size < 0) { throw std::invalid_argument("bad --pipe-size"); }
+        } else if (arg == "--timeout") {
+            if (i+1 == argc) { throw std::invalid_argument("bad --timeout"); }
+            double seconds = 0;
+            std::stringstream tmp(argv[++i]);
+            tmp >> seconds;
+            if (!tmp || seconds < 0) { throw std::invalid_argument("bad --timeout"); }
+            using namespace std::chrono;
+            this->_timeout = duration_cast<line_info::clock_type::duration>(
+                std::chrono::duration<double>(seconds));
+        } else if (arg == "--test-threads") {
+            if (i+1 == argc) { throw std::invalid_argument("bad --test-threads"); }
+            std::stringstream tmp(argv[++i]);
+            tmp >> this->_num_test_threads;
+            if (!tmp) { throw std::invalid_argument("bad --test-threads"); }
+        } else if (arg == "--readers") {
+            if (i+1 == argc) { throw std::invalid_argument("bad --readers"); }
+            std::stringstream tmp(argv[++i]);
+            tmp >> this->_num_readers;
+            if (!tmp || this->_num_readers == 0) { throw std::invalid_argument("bad --readers"); }
+        } else if (arg == "--zero-copy") {
+            this->_zero_copy = true;
+        } else if (arg == "--event-ring") {
+            if (i+1 == argc) { throw std::invalid_argument("bad --event-ring"); }
+            size_t kilobytes = 0;
+            std::stringstream tmp(argv[++i]);
+            tmp >> kilobytes;
+            if (!tmp) { throw std::invalid_argument("bad --event-ring"); }
+            this->_event_ring_size = kilobytes*1024UL;
+        } else if (arg == "--event-watermark") {
+            if (i+1 == argc) { throw std::invalid_argument("bad --event-watermark"); }
+            std::stringstream tmp(argv[++i]);
+            tmp >> this->_event_ring_watermark;
+            if (!tmp) { throw std::invalid_argument("bad --event-watermark"); }
+        } else if (arg == "--record") {
+            if (i+1 == argc) { throw std::invalid_argument("bad --record"); }
+            this->_record_file = argv[++i];
+        } else if (arg == "--replay") {
+            if (i+1 == argc) { throw std::invalid_argument("bad --replay"); }
+            this->_replay_file = argv[++i];
+        } else if (arg == "--capture") {
+            if (i+1 == argc) { throw std::invalid_argument("bad --capture"); }
+            this->_capture_file = argv[++i];
+            this->_capture_traffic = true;
+        } else if (arg == "--traffic") {
+            this->_capture_traffic = true;
+        } else if (arg == "--perf-counters") {
+            this->_perf_counters = true;
+        } else if (arg == "--tmpfs") {
+            if (i+1 == argc) { throw std::invalid_argument("bad --tmpfs"); }
+            this->_tmpfs_path = argv[++i];
+            if (this->_tmpfs_path.empty()) { throw std::invalid_argument("bad --tmpfs"); }
+        } else if (arg == "--tmpfs-size") {
+            if (i+1 == argc) { throw std::invalid_argument("bad --tmpfs-size"); }
+            size_t megabytes = 0;
+            std::stringstream tmp(argv[++i]);
+            tmp >> megabytes;
+            if (!tmp) { throw std::invalid_argument("bad --tmpfs-size"); }
+            this->_tmpfs_size = megabytes*1024UL*1024UL;
         } else {
             std::stringstream tmp;
             tmp << "unknown argument: " << arg;
@@ -125,56 +390,381 @@ void dts::application::add_process(cluster_node_bitmap nodes, sys::argstream arg
 }
 
 void dts::application::run_process(cluster_node_bitmap where, sys::argstream args) {
+    lock_type lock(this->_mutex);
+    const auto process_no = this->_arguments.size();
+    this->_where.emplace_back(std::move(where));
+    this->_arguments.emplace_back(std::move(args));
     const auto num_nodes = this->_cluster.size();
     for (size_t i=0; i<num_nodes; ++i) {
-        if (!where.matches(i)) { continue; }
-        auto& node = this->_cluster.nodes()[i];
-        sys::pipe stdout, stderr;
-        stdout.out().unsetf(sys::open_flag::non_blocking);
-        stderr.out().unsetf(sys::open_flag::non_blocking);
-        {
-            std::stringstream tmp;
-            tmp << node.name() << ": ";
-            std::copy(args.argv(), args.argv() + args.argc(),
-                      sys::intersperse_iterator<char*,char>(tmp, ' '));
-            this->log("_", tmp.str());
-        }
-        this->_child_processes.emplace([&] () {
+        if (!this->_where[process_no].matches(i)) { continue; }
+        launch_process(i, process_no);
+    }
+}
+
+void dts::application::launch_process(size_t node_no, size_t process_no) {
+    const auto& args = this->_arguments[process_no];
+    // the child waits until its performance counters are opened
+    std::unique_ptr<sys::pipe> gate;
+    if (this->_perf_counters) {
+        gate.reset(new sys::pipe);
+        gate->in().unsetf(sys::open_flag::non_blocking);
+        gate->out().unsetf(sys::open_flag::non_blocking);
+    }
+    if (this->_cluster.size() == 1) {
+        const auto& node = this->_cluster.nodes()[node_no];
+        this->_child_processes.emplace([&args,&node,&gate] () {
             std::set_terminate(print_stack_trace);
-            stdout.in().close();
-            stderr.in().close();
-            sys::fildes out(STDOUT_FILENO);
-            out = stdout.out();
-            sys::fildes err(STDERR_FILENO);
-            err = stderr.out();
-            sys::this_process::enter(node.network_namespace().fd());
-            sys::this_process::enter(node.hostname_namespace().fd());
+            enter_mount_namespace(node.mount_namespace());
+            wait_for_parent(gate.get());
             return sys::this_process::execute_command(args.argv());
         });
-        this->_child_process_nodes.emplace_back(i);
-        stdout.out().close();
-        stderr.out().close();
-        lock_type lock(this->_mutex);
-        this->_output.emplace_back(node.veth().name()+": ", std::move(stdout.in()), 1);
-        this->_poller.emplace(this->_output.back().in().fd(), sys::event::in);
-        this->_output.emplace_back(node.veth().name()+": ", std::move(stderr.in()), 2);
-        this->_poller.emplace(this->_output.back().in().fd(), sys::event::in);
-        this->_poller.notify_one();
+        this->_child_process_nodes.emplace_back(node_no);
+        this->_child_process_arguments.emplace_back(process_no);
+        this->_child_process_reaped.emplace_back(0);
+        open_perf_counters(this->_child_processes.back().id());
+        if (gate) { gate->out().write("x", 1); }
+        return;
     }
-    this->_where.emplace_back(std::move(where));
-    this->_arguments.emplace_back(std::move(args));
+    auto& node = this->_cluster.nodes()[node_no];
+    sys::pipe stdout, stderr, events;
+    stdout.out().unsetf(sys::open_flag::non_blocking);
+    stderr.out().unsetf(sys::open_flag::non_blocking);
+    set_pipe_size(stdout.in());
+    set_pipe_size(stderr.in());
+    events.out().unsetf(sys::open_flag::non_blocking);
+    std::unique_ptr<event_ring> ring;
+    if (this->_event_ring_size != 0) {
+        ring.reset(new event_ring(this->_event_ring_size, node_no, this->_event_ring_watermark));
+    }
+    {
+        std::stringstream tmp;
+        tmp << node.name() << ": ";
+        std::copy(args.argv(), args.argv() + args.argc(),
+                  sys::intersperse_iterator<char*,char>(tmp, ' '));
+        this->log("_", tmp.str());
+    }
+    // restarts launch processes from another thread
+    child_environment env;
+    env.set("DTEST_EVENT_FD", std::to_string(events.out().fd()));
+    if (ring) { env.set("DTEST_EVENT_RING", ring->environment()); }
+    env.set("DTEST_INTERFACE_ADDRESS", format(node.peer_interface_address()));
+    this->_child_processes.emplace([&] () {
+        std::set_terminate(print_stack_trace);
+        stdout.in().close();
+        stderr.in().close();
+        sys::fildes out(STDOUT_FILENO);
+        out = stdout.out();
+        sys::fildes err(STDERR_FILENO);
+        err = stderr.out();
+        set_event_channel(events);
+        if (ring) { ring->inherit(); }
+        env.apply();
+        sys::this_process::enter(node.network_namespace().fd());
+        sys::this_process::enter(node.hostname_namespace().fd());
+        enter_mount_namespace(node.mount_namespace());
+        wait_for_parent(gate.get());
+        return sys::this_process::execute_command(args.argv());
+    });
+    this->_child_process_nodes.emplace_back(node_no);
+    this->_child_process_arguments.emplace_back(process_no);
+    this->_child_process_reaped.emplace_back(0);
+    open_perf_counters(this->_child_processes.back().id());
+    if (gate) { gate->out().write("x", 1); }
+    stdout.out().close();
+    stderr.out().close();
+    events.out().close();
+    add_output(node.veth().name()+": ", std::move(stdout.in()), 1, node_no);
+    add_output(node.veth().name()+": ", std::move(stderr.in()), 2, node_no);
+    this->_event_output.emplace_back(std::move(events.in()), node_no);
+    this->_poller.emplace(this->_event_output.back().in().fd(), sys::event::in);
+    if (ring) {
+        this->_event_rings.emplace_back(std::move(*ring));
+        this->_poller.emplace(this->_event_rings.back().in().fd(), sys::event::in);
+    }
+    this->_poller.notify_one();
 }
 
-void dts::application::kill_process(cluster_node_bitmap where, sys::signal signal) {
+void dts::application::open_perf_counters(sys::pid_type pid) {
+    if (!this->_perf_counters) {
+        this->_child_process_counters.emplace_back();
+        return;
+    }
+    this->_child_process_counters.emplace_back(pid);
+}
+
+dts::perf_values dts::application::counters(size_t node_no, size_t process_no) const {
+    lock_type lock(this->_mutex);
+    perf_values result;
+    const auto n = this->_child_process_counters.size();
+    for (size_t i=0; i<n; ++i) {
+        if (node_no != any_node && this->_child_process_nodes[i] != node_no) { continue; }
+        if (process_no != any_process &&
+            this->_child_process_arguments[i] != process_no) { continue; }
+        result += this->_child_process_counters[i].read();
+    }
+    return result;
+}
+
+void dts::application::report_perf_counters() const {
+    const auto& nodes = this->_cluster.nodes();
+    const auto num_nodes = nodes.size();
     const auto num_processes = this->_arguments.size();
+    std::cerr << "dtest: Performance counters:\n";
+    for (size_t i=0; i<num_nodes; ++i) {
+        for (size_t j=0; j<num_processes; ++j) {
+            if (!this->_where[j].matches(i)) { continue; }
+            const auto& args = this->_arguments[j];
+            std::cerr << "dtest: " << nodes[i].name() << " exec " << (j+1) << " ("
+                << (args.argc() == 0 ? "" : args.argv()[0]) << "): "
+                << counters(i, j) << '\n';
+        }
+        std::cerr << "dtest: " << nodes[i].name() << " total: " << counters(i) << '\n';
+    }
+}
+
+dts::traffic_summary dts::application::traffic(size_t node_no) {
+    lock_type lock(this->_mutex);
+    if (node_no != any_node && node_no >= this->_cluster.size()) {
+        throw std::invalid_argument("bad node");
+    }
+    this->_packet_capture.read();
+    const auto& summaries = this->_packet_capture.summaries();
+    if (node_no != any_node) {
+        return node_no < summaries.size() ? summaries[node_no] : traffic_summary();
+    }
+    traffic_summary result;
+    for (const auto& s : summaries) {
+        result.packets_sent += s.packets_sent;
+        result.bytes_sent += s.bytes_sent;
+        result.packets_received += s.packets_received;
+        result.bytes_received += s.bytes_received;
+    }
+    return result;
+}
+
+void dts::application::report_traffic() const {
+    const auto& nodes = this->_cluster.nodes();
+    const auto& summaries = this->_packet_capture.summaries();
+    const auto n = std::min(nodes.size(), summaries.size());
+    std::cerr << "dtest: Traffic:\n";
+    for (size_t i=0; i<n; ++i) {
+        std::cerr << "dtest: " << nodes[i].name() << ": " << summaries[i] << '\n';
+    }
+    if (const auto dropped = this->_packet_capture.dropped()) {
+        std::cerr << "dtest: " << dropped << " frames were dropped\n";
+    }
+}
+
+sys::fildes dts::application::make_mount_namespace() const {
+    sys::two_way_pipe pipe;
+    pipe.parent_in().unsetf(sys::open_flag::non_blocking);
+    pipe.parent_out().unsetf(sys::open_flag::non_blocking);
+    pipe.child_in().unsetf(sys::open_flag::non_blocking);
+    pipe.child_out().unsetf(sys::open_flag::non_blocking);
+    const auto& path = this->_tmpfs_path;
+    const auto size = this->_tmpfs_size;
+    // the process only holds the namespace until the parent opens it,
+    // the namespace (and the tmpfs) is destroyed when the last descriptor is closed
+    sys::process proc([&] () {
+        std::set_terminate(print_stack_trace);
+        pipe.close_in_child();
+        unshare_tmpfs(path, size);
+        char ch = 'x';
+        pipe.child_out().write(&ch, 1);
+        pipe.child_in().read(&ch, 1);
+        return 0;
+    }, sys::process_flag::signal_parent);
+    pipe.close_in_parent();
+    char ch = 0;
+    if (pipe.parent_in().read(&ch, 1) != 1) {
+        proc.wait();
+        std::stringstream tmp;
+        tmp << "failed to mount tmpfs at " << path;
+        throw std::runtime_error(tmp.str());
+    }
+    auto ns = proc.get_namespace("mnt");
+    pipe.parent_out().write("x", 1);
+    proc.wait();
+    return ns;
+}
+
+void dts::application::kill_process(cluster_node_bitmap where, sys::signal signal) {
+    lock_type lock(this->_mutex);
+    const auto num_processes = this->_child_processes.size();
+    for (size_t i=0; i<num_processes; ++i) {
+        if (i >= this->_child_process_nodes.size() || reaped(i)) { continue; }
+        auto node = this->_child_process_nodes[i];
+        if (!where.matches(node)) { continue; }
+        auto& process = this->_child_processes[i];
+        log("send _ to child process _ running on node _", signal, process.id(), node);
+        process.send(signal);
+    }
+}
+
+void dts::application::restart_node(cluster_node_bitmap where, sys::signal signal,
+                                     duration delay) {
+    struct victim { size_t index; sys::pid_type id; size_t node; size_t process_no; };
+    std::vector<victim> victims;
+    lock_type lock(this->_mutex);
+    const auto num_processes = this->_child_processes.size();
     for (size_t i=0; i<num_processes; ++i) {
-        if (i >= this->_child_process_nodes.size()) { continue; }
+        if (i >= this->_child_process_nodes.size() || reaped(i)) { continue; }
         auto node = this->_child_process_nodes[i];
         if (!where.matches(node)) { continue; }
         auto& process = this->_child_processes[i];
         log("send _ to child process _ running on node _", signal, process.id(), node);
         process.send(signal);
+        victims.push_back({i, process.id(), node, this->_child_process_arguments[i]});
+    }
+    // join the threads of the previous restarts
+    for (auto first=this->_restart_threads.begin(); first!=this->_restart_threads.end(); ) {
+        if (first->finished) {
+            first->thread.join();
+            first = this->_restart_threads.erase(first);
+        } else {
+            ++first;
+        }
+    }
+    // reap killed processes in a separate thread, tests continue to run meanwhile
+    this->_restart_threads.emplace_back();
+    auto finished = &this->_restart_threads.back().finished;
+    this->_restart_threads.back().thread = std::thread([this,victims,delay,finished] () {
+        for (const auto& v : victims) {
+            int status = 0;
+            // the same escalation as in signal handler: kill after three seconds
+            using clock_type = std::chrono::steady_clock;
+            const auto deadline = clock_type::now() + std::chrono::seconds(3);
+            sys::pid_type ret;
+            while ((ret = ::waitpid(v.id, &status, WNOHANG)) == 0 &&
+                   clock_type::now() < deadline) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            if (ret == 0) {
+                this->log("kill child process _ on node _", v.id, v.node);
+                ::kill(v.id, SIGKILL);
+                while (::waitpid(v.id, &status, 0) == -1 && errno == EINTR) {}
+            }
+            lock_type lock(this->_mutex);
+            this->_child_process_reaped[v.index] = 1;
+            this->log("child process _ on node _ terminated: status _", v.id, v.node, status);
+        }
+        std::this_thread::sleep_for(delay);
+        lock_type lock(this->_mutex);
+        *finished = true;
+        if (this->_stopped || this->_tests_succeeded || this->_timed_out) { return; }
+        for (const auto& v : victims) {
+            this->log("restart process _ on node _", v.process_no, v.node);
+            launch_process(v.node, v.process_no);
+        }
+    });
+}
+
+constexpr const size_t dts::application::any_node;
+constexpr const size_t dts::application::any_process;
+
+size_t dts::application::wait_for_lines(const string_array& regex_strings, size_t node_no,
+                                        line_array::size_type first,
+                                        line_waiter::callback_type callback) {
+    lock_type lock(this->_mutex);
+    std::string prefix;
+    if (node_no != any_node) {
+        if (node_no >= this->_cluster.size()) { throw std::invalid_argument("bad node"); }
+        prefix = this->_cluster.nodes()[node_no].name() + ": ";
+    }
+    const auto id = this->_num_waiters++;
+    line_waiter waiter(regex_strings, std::move(prefix), first, std::move(callback));
+    if (!waiter.screen(this->_lines)) { this->_line_waiters.emplace_back(id, std::move(waiter)); }
+    return id;
+}
+
+dts::extracted_columns
+dts::application::extract(const std::string& regex_string, const field_array& fields,
+                          size_t node_no) const {
+    line_regex expr(regex_string);
+    lock_type lock(this->_mutex);
+    if (node_no != any_node && node_no >= this->_cluster.size()) {
+        throw std::invalid_argument("bad node");
+    }
+    std::vector<size_t> stream_nodes;
+    stream_nodes.reserve(this->_output.size());
+    for (const auto& output : this->_output) { stream_nodes.emplace_back(output.node()); }
+    return ::dts::extract(this->_lines, expr, fields, stream_nodes, node_no);
+}
+
+size_t dts::application::wait_for_exit(cluster_node_bitmap where,
+                                       process_waiter::callback_type callback) {
+    lock_type lock(this->_mutex);
+    std::vector<::pid_t> processes;
+    const auto num_processes = this->_child_processes.size();
+    for (size_t i=0; i<num_processes; ++i) {
+        if (i >= this->_child_process_nodes.size() || reaped(i)) { continue; }
+        if (!where.matches(this->_child_process_nodes[i])) { continue; }
+        processes.emplace_back(this->_child_processes[i].id());
+    }
+    const auto id = this->_num_waiters++;
+    process_waiter waiter(std::move(processes), std::move(callback));
+    if (!waiter.screen()) {
+        for (const auto& fd : waiter.descriptors()) {
+            this->_poller.emplace(fd.fd(), sys::event::in);
+        }
+        this->_process_waiters.emplace_back(id, std::move(waiter));
+    }
+    return id;
+}
+
+size_t dts::application::wait_until(line_info::time_point deadline,
+                                    timer_waiter::callback_type callback) {
+    lock_type lock(this->_mutex);
+    const auto id = this->_num_waiters++;
+    timer_waiter waiter(deadline, std::move(callback));
+    if (!waiter.screen(line_info::clock_type::now())) {
+        this->_timer_waiters.emplace_back(id, std::move(waiter));
+        if (!this->_timed_out) { arm_timer(); }
+    }
+    return id;
+}
+
+namespace {
+
+    template <class Waiter>
+    void erase_waiter(std::vector<std::pair<size_t,Waiter>>& waiters, size_t id) {
+        waiters.erase(std::remove_if(waiters.begin(), waiters.end(),
+                                     [id] (const std::pair<size_t,Waiter>& p) {
+                                         return p.first == id;
+                                     }), waiters.end());
+    }
+
+    /// Callbacks may add new waiters (e.g. resumed coroutines), hence the waiters
+    /// are screened outside of the vector.
+    template <class Waiter, class Screen>
+    void screen_waiters(std::vector<std::pair<size_t,Waiter>>& waiters, Screen screen) {
+        if (waiters.empty()) { return; }
+        auto pending = std::move(waiters);
+        waiters.clear();
+        pending.erase(std::remove_if(pending.begin(), pending.end(),
+                                     [&screen] (std::pair<size_t,Waiter>& p) {
+                                         return screen(p.second);
+                                     }), pending.end());
+        for (auto& p : waiters) { pending.emplace_back(std::move(p)); }
+        waiters = std::move(pending);
     }
+
+}
+
+void dts::application::cancel_waiter(size_t id) {
+    lock_type lock(this->_mutex);
+    erase_waiter(this->_line_waiters, id);
+    erase_waiter(this->_process_waiters, id);
+    erase_waiter(this->_timer_waiters, id);
+}
+
+void dts::application::notify_waiters() {
+    screen_waiters(this->_line_waiters, [this] (line_waiter& w) {
+        return w.screen(this->_lines);
+    });
+    screen_waiters(this->_process_waiters, [] (process_waiter& w) { return w.screen(); });
+    const auto now = line_info::clock_type::now();
+    screen_waiters(this->_timer_waiters, [now] (timer_waiter& w) { return w.screen(now); });
 }
 
 int dts::application::wait() {
@@ -182,6 +772,10 @@ int dts::application::wait() {
     if (!this->_no_tests) {
         this->_tests_completed.get_future().get();
     }
+    // restarted processes are launched or skipped after the tests are completed
+    for (auto& t : this->_restart_threads) {
+        if (t.thread.joinable()) { t.thread.join(); }
+    }
     if (this->_exit_code == exit_code_type::all ||
         this->_exit_code == exit_code_type::none) {
         retval = accumulate_return_value();
@@ -191,7 +785,7 @@ int dts::application::wait() {
     } else if (this->_exit_code == exit_code_type::master) {
         auto nprocs = this->_child_processes.size();
         // wait for master process
-        if (nprocs > 0 && this->_child_processes.front()) {
+        if (nprocs > 0 && !reaped(0) && this->_child_processes.front()) {
             auto stat = this->_child_processes.front().wait();
             this->log("master process terminated: _", stat);
             retval = stat.exit_code() | sys::signal_type(stat.term_signal());
@@ -199,6 +793,7 @@ int dts::application::wait() {
         // terminate child processes
         if (nprocs > 1) {
             for (size_t i=1; i<nprocs; ++i) {
+                if (reaped(i)) { continue; }
                 auto& proc = this->_child_processes[i];
                 if (proc) { proc.terminate(); }
                 auto stat = proc.wait();
@@ -208,13 +803,13 @@ int dts::application::wait() {
     } else {
         size_t proc_no = static_cast<size_t>(this->_exit_code);
         auto nprocs = this->_child_processes.size();
-        if (proc_no < nprocs) {
+        if (proc_no < nprocs && !reaped(proc_no)) {
             auto status = this->_child_processes[proc_no].wait();
             this->log("process #_ terminated: _", proc_no, status);
             retval = status.exit_code() | sys::signal_type(status.term_signal());
         }
         for (size_t i=0; i<nprocs; ++i) {
-            if (i == proc_no) { continue; }
+            if (i == proc_no || reaped(i)) { continue; }
             auto& proc = this->_child_processes[i];
             if (proc) { proc.terminate(); }
             auto stat = proc.wait();
@@ -222,16 +817,35 @@ int dts::application::wait() {
         }
     }
     this->_stopped = true;
+    for (auto& shard : this->_shards) { shard->poller.notify_one(); }
+    for (auto& shard : this->_shards) {
+        if (shard->thread.joinable()) { shard->thread.join(); }
+    }
     this->_poller.notify_one();
     if (this->_output_thread.joinable()) { this->_output_thread.join(); }
+    {
+        // the events that were written after the last wakeup
+        lock_type lock(this->_mutex);
+        drain_events();
+    }
+    this->_recording.close();
+    if (!this->_stats_file.empty()) { write_stats_file(); }
+    if (this->_print_metrics) { report_metrics(); }
+    if (this->_perf_counters) { report_perf_counters(); }
+    if (this->_packet_capture) {
+        this->_packet_capture.close();
+        report_traffic();
+    }
     if (this->_no_tests) { return retval; }
     return this->_tests_succeeded ? 0 : 1;
 }
 
 int dts::application::accumulate_return_value() {
     int ret = 0;
-    for (auto& proc : this->_child_processes) {
-        auto stat = proc.wait();
+    const auto nprocs = this->_child_processes.size();
+    for (size_t i=0; i<nprocs; ++i) {
+        if (reaped(i)) { continue; }
+        auto stat = this->_child_processes[i].wait();
         this->log("child process terminated: _", stat);
         ret |= stat.exit_code() | sys::signal_type(stat.term_signal());
     }
@@ -254,23 +868,34 @@ void dts::application::validate() {
             throw std::runtime_error(msg.str());
         }
     }
+    if (this->_capture_traffic && num_nodes == 1) {
+        throw std::invalid_argument("single-node cluster does not have the bridge to capture");
+    }
 }
 
 void dts::application::run() {
     validate();
     this->_no_tests = this->_tests.empty();
+    build_test_graph();
+    if (!this->_tmpfs_path.empty()) {
+        for (auto& node : this->_cluster.nodes()) {
+            node.mount_namespace(make_mount_namespace());
+        }
+    }
     if (this->_cluster.size() == 1) {
         { sys::network_interface lo("lo"); lo.setf(sys::network_interface::flag::up); }
-        for (const auto& a : this->_arguments) {
-            this->_child_processes.emplace([&a] () {
-                std::set_terminate(print_stack_trace);
-                return sys::this_process::execute_command(a.argv());
-            });
-        }
+        const auto num_processes = this->_arguments.size();
+        for (size_t j=0; j<num_processes; ++j) { launch_process(0, j); }
     } else {
         auto& nodes = this->_cluster.nodes();
         auto num_nodes = nodes.size();
         auto num_processes = this->_arguments.size();
+        if (this->_num_readers > 1) {
+            for (size_t i=0; i<this->_num_readers; ++i) {
+                this->_shards.emplace_back(new reader_shard);
+            }
+            this->_batches.resize(this->_num_readers);
+        }
         using f = sys::network_interface::flag;
         using sys::this_process::execute_command;
         using sys::this_process::enter;
@@ -296,9 +921,22 @@ void dts::application::run() {
                 pipe.parent_out().unsetf(sys::open_flag::non_blocking);
                 pipe.child_in().unsetf(sys::open_flag::non_blocking);
                 pipe.child_out().unsetf(sys::open_flag::non_blocking);
-                sys::pipe stdout, stderr;
+                sys::pipe stdout, stderr, events;
                 stdout.out().unsetf(sys::open_flag::non_blocking);
                 stderr.out().unsetf(sys::open_flag::non_blocking);
+                set_pipe_size(stdout.in());
+                set_pipe_size(stderr.in());
+                events.out().unsetf(sys::open_flag::non_blocking);
+                if (this->_event_ring_size != 0) {
+                    this->_event_rings.emplace_back(this->_event_ring_size, i,
+                                                    this->_event_ring_watermark);
+                }
+                child_environment env;
+                env.set("DTEST_EVENT_FD", std::to_string(events.out().fd()));
+                if (this->_event_ring_size != 0) {
+                    env.set("DTEST_EVENT_RING", this->_event_rings.back().environment());
+                }
+                env.set("DTEST_INTERFACE_ADDRESS", format(node.peer_interface_address()));
                 using pf = sys::process_flag;
                 this->_child_processes.emplace([&] () {
                     std::set_terminate(print_stack_trace);
@@ -312,10 +950,11 @@ void dts::application::run() {
                         enter(node.network_namespace().fd());
                         enter(node.hostname_namespace().fd());
                     }
+                    enter_mount_namespace(node.mount_namespace());
                     pipe.close_in_child();
-                    std::stringstream tmp;
-                    tmp << node.peer_interface_address();
-                    ::setenv("DTEST_INTERFACE_ADDRESS", tmp.str().data(), 1);
+                    set_event_channel(events);
+                    if (this->_event_ring_size != 0) { this->_event_rings.back().inherit(); }
+                    env.apply();
                     char ch;
                     pipe.child_in().read(&ch, 1);
                     sys::this_process::hostname(veth.name());
@@ -330,11 +969,17 @@ void dts::application::run() {
                     return 0;
                 }, pf::signal_parent | pf::unshare_network | pf::unshare_hostname);
                 this->_child_process_nodes.emplace_back(i);
+                this->_child_process_arguments.emplace_back(j);
+                this->_child_process_reaped.emplace_back(0);
+                // the child is blocked on the pipe until all processes are launched
+                open_perf_counters(this->_child_processes.back().id());
                 pipe.close_in_parent();
                 stdout.out().close();
                 stderr.out().close();
-                this->_output.emplace_back(veth.name()+": ", std::move(stdout.in()), 1);
-                this->_output.emplace_back(veth.name()+": ", std::move(stderr.in()), 2);
+                events.out().close();
+                add_output(veth.name()+": ", std::move(stdout.in()), 1, i);
+                add_output(veth.name()+": ", std::move(stderr.in()), 2, i);
+                this->_event_output.emplace_back(std::move(events.in()), i);
                 auto& proc = this->_child_processes.back();
                 node.network_namespace(proc.get_namespace("net"));
                 node.hostname_namespace(proc.get_namespace("uts"));
@@ -370,12 +1015,32 @@ void dts::application::run() {
                 throw std::runtime_error(tmp.str());
             }
         }
+        if (this->_capture_traffic) {
+            this->_packet_capture = packet_capture(br.index(), nodes, this->_capture_file);
+            this->_poller.emplace(this->_packet_capture.in().fd(), sys::event::in);
+        }
         // launch all processes simultaneously
         for (auto& pipe : pipes) { pipe.parent_out().write("x", 1); }
         this->_cluster.bridge(std::move(br));
-        for (const auto& output : this->_output) {
+        for (const auto& output : this->_event_output) {
             this->_poller.emplace(output.in().fd(), sys::event::in);
         }
+        for (const auto& ring : this->_event_rings) {
+            this->_poller.emplace(ring.in().fd(), sys::event::in);
+        }
+        if (!this->_record_file.empty()) {
+            this->_recording = recording_writer(this->_record_file);
+        }
+        this->_start_time = line_info::clock_type::now();
+        if (!this->_no_tests) { start_tests(this->_start_time); }
+        this->_timer = sys::fildes(::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC));
+        if (!this->_timer) { throw std::system_error(errno, std::generic_category()); }
+        this->_poller.emplace(this->_timer.fd(), sys::event::in);
+        arm_timer();
+        for (auto& shard : this->_shards) {
+            auto ptr = shard.get();
+            shard->thread = std::thread([this,ptr] () { read_shard(*ptr); });
+        }
         this->_output_thread = std::thread([this] () { process_events(); });
     }
 }
@@ -385,16 +1050,44 @@ void dts::application::process_events() {
         using namespace sys::this_process;
         ignore_signal(sys::signal::broken_pipe);
         lock_type lock(this->_mutex);
+        using clock_type = ::dts::metrics::clock_type;
         this->_poller.wait(lock, [this,&lock] () {
-            for (auto& output : this->_output) {
-                output.copy(this->_lines);
+            this->_metrics.wakeup();
+            const auto old_size = this->_lines.size();
+            auto t0 = clock_type::now();
+            if (this->_shards.empty()) {
+                const auto num_outputs = this->_output.size();
+                for (size_t i=0; i<num_outputs; ++i) {
+                    this->_output[i].copy(this->_lines, i);
+                }
+            } else {
+                merge_shards();
             }
+            drain_events();
+            if (this->_packet_capture) { this->_packet_capture.read(); }
+            notify_waiters();
+            auto t1 = clock_type::now();
+            this->_metrics.copy(t1-t0);
+            this->_metrics.line_memory(this->_lines.memory());
+            if (this->_recording) { record(old_size); }
             if (!this->_no_tests) {
-                if (!this->_tests_succeeded && run_tests()) {
+                screen_tests(old_size);
+                if (!this->_tests_succeeded && !this->_timed_out && run_tests(lock)) {
                     this->_tests_succeeded = true;
                     this->_tests_completed.set_value();
                     this->send(sys::signal::terminate);
                 }
+                this->_metrics.run_tests(clock_type::now()-t1);
+            }
+            this->_lines.shrink();
+            if (!this->_timed_out) {
+                if (!this->_no_tests) { start_tests(line_info::clock_type::now()); }
+                check_deadlines();
+                arm_timer();
+            }
+            if (!this->_stats_file.empty() &&
+                clock_type::now()-this->_stats_time >= this->_stats_interval) {
+                write_stats_file();
             }
             return stopped();
         });
@@ -403,20 +1096,94 @@ void dts::application::process_events() {
     }
 }
 
-bool dts::application::run_tests() {
+void dts::application::drain_events() {
+    // the end of file of the event pipe wakes up the output thread when
+    // the process exits, and the rings are drained on every wakeup,
+    // hence the events below the watermark are never stranded
+    // malformed record of one process does not stop the other channels
+    for (auto& output : this->_event_output) {
+        try {
+            output.copy(this->_events);
+        } catch (const std::invalid_argument& err) {
+            log("discard events of node _: _", output.node(), err.what());
+            output.discard();
+        }
+    }
+    for (auto& ring : this->_event_rings) {
+        try {
+            ring.copy(this->_events);
+        } catch (const std::invalid_argument& err) {
+            log("discard events of node _: _", ring.node(), err.what());
+            ring.discard();
+        }
+    }
+}
+
+void dts::application::read_shard(reader_shard& shard) {
+    try {
+        using namespace sys::this_process;
+        ignore_signal(sys::signal::broken_pipe);
+        lock_type lock(shard.mutex);
+        std::vector<line_array> batch(1);
+        shard.poller.wait(lock, [this,&shard,&batch] () {
+            for (auto& pair : shard.streams) { pair.first->copy(batch.front(), pair.second); }
+            if (!batch.front().empty()) {
+                {
+                    std::lock_guard<std::mutex> guard(shard.ready_mutex);
+                    shard.ready.front().merge(batch);
+                }
+                this->_poller.notify_one();
+            }
+            return stopped();
+        });
+    } catch (const std::exception& err) {
+        log("reader _", err.what());
+    }
+}
+
+void dts::application::merge_shards() {
+    const auto num_shards = this->_shards.size();
+    for (size_t i=0; i<num_shards; ++i) {
+        auto& shard = *this->_shards[i];
+        std::lock_guard<std::mutex> guard(shard.ready_mutex);
+        std::swap(this->_batches[i], shard.ready.front());
+    }
+    this->_lines.merge(this->_batches);
+}
+
+bool dts::application::run_tests(lock_type& lock) {
+    if (this->_num_test_threads != 0) { return run_tests_concurrently(lock); }
     while (!this->_tests.empty()) {
         auto& test = this->_tests.front();
-        try {
-            test(*this, this->_lines);
+        if (!test.triggered()) { break; }
+        using clock_type = ::dts::metrics::clock_type;
+        auto t0 = clock_type::now();
+        test.start(t0);
+        auto test_failed = [&test,t0] (std::string what) {
+            test.durations().add(clock_type::now()-t0);
             std::cerr << "dtest: " << test.description() << '\n';
-            std::cerr << "dtest: Completed successfully.\n";
-        } catch (const std::exception& err) {
-            std::cerr << "dtest: " << test.description() << '\n';
-            std::string what = err.what();
             std::cerr << "dtest: " << what;
             if (what.empty() || what.back() != '\n') {
                 std::cerr << '\n';
             }
+            test.evaluated();
+            test.last_error(std::move(what));
+        };
+        try {
+            test(*this, this->_lines);
+            test.durations().add(clock_type::now()-t0);
+            this->_metrics.test(test.description(), test.durations());
+            std::cerr << "dtest: " << test.description() << '\n';
+            std::cerr << "dtest: Completed successfully.\n";
+        } catch (const test_pending&) {
+            test.durations().add(clock_type::now()-t0);
+            test.evaluated();
+            break;
+        } catch (const std::exception& err) {
+            test_failed(err.what());
+            break;
+        } catch (...) {
+            test_failed("unknown exception");
             break;
         }
         this->_tests.pop();
@@ -427,9 +1194,386 @@ bool dts::application::run_tests() {
     return this->_tests.empty();
 }
 
-void dts::process_output::copy(string_array& lines) {
+void dts::application::screen_tests(line_array::size_type first) {
+    if (this->_num_test_threads == 0) {
+        // only the first test in the queue is evaluated
+        if (!this->_tests.empty()) { this->_tests.front().screen(this->_lines, first); }
+        return;
+    }
+    const auto num_tests = this->_test_graph.size();
+    for (size_t i=0; i<num_tests; ++i) {
+        if (!this->_test_succeeded[i]) { this->_test_graph[i].screen(this->_lines, first); }
+    }
+}
+
+void dts::application::start_tests(line_info::time_point now) {
+    // the clock starts even if the test is never evaluated (e.g. no new lines)
+    if (this->_num_test_threads == 0) {
+        if (!this->_tests.empty()) { this->_tests.front().start(now); }
+        return;
+    }
+    const auto num_tests = this->_test_graph.size();
+    for (size_t i=0; i<num_tests; ++i) {
+        if (this->_test_succeeded[i]) { continue; }
+        bool all = true;
+        for (auto j : this->_test_dependencies[i]) {
+            if (!this->_test_succeeded[j]) { all = false; break; }
+        }
+        if (all) { this->_test_graph[i].start(now); }
+    }
+}
+
+void dts::application::check_deadlines() {
+    std::uint64_t nexpirations = 0;
+    while (::read(this->_timer.fd(), &nexpirations, sizeof(nexpirations)) == -1 &&
+           errno == EINTR) {}
+    const auto now = line_info::clock_type::now();
+    const bool global = this->_timeout != line_info::clock_type::duration::zero() &&
+        now-this->_start_time >= this->_timeout;
+    std::vector<const test*> expired;
+    if (this->_num_test_threads == 0) {
+        if (!this->_tests.empty()) {
+            const auto& test = this->_tests.front();
+            if ((global && test.started()) || test.expired(now)) { expired.emplace_back(&test); }
+        }
+    } else {
+        const auto num_tests = this->_test_graph.size();
+        for (size_t i=0; i<num_tests; ++i) {
+            const auto& test = this->_test_graph[i];
+            if (this->_test_succeeded[i]) { continue; }
+            if ((global && test.started()) || test.expired(now)) { expired.emplace_back(&test); }
+        }
+    }
+    if (!global && expired.empty()) { return; }
+    using seconds = std::chrono::duration<double>;
+    for (const auto* test : expired) {
+        const auto elapsed = std::chrono::duration_cast<seconds>(now-test->start_time());
+        std::cerr << "dtest: " << test->description() << '\n';
+        std::cerr << "dtest: Timed out after " << elapsed.count() << "s.\n";
+        const auto& what = test->last_error();
+        if (!what.empty()) {
+            std::cerr << "dtest: " << what;
+            if (what.back() != '\n') { std::cerr << '\n'; }
+        }
+    }
+    if (global) {
+        const auto elapsed = std::chrono::duration_cast<seconds>(now-this->_start_time);
+        std::cerr << "dtest: Timed out after " << elapsed.count() << "s.\n";
+    }
+    this->_timed_out = true;
+    if (!this->_no_tests && !this->_tests_succeeded) { this->_tests_completed.set_value(); }
+    // the same escalation as in signal handler: terminate, then kill after three seconds
+    this->send(sys::signal::terminate);
+    ::alarm(3);
+}
+
+void dts::application::arm_timer() {
+    if (!this->_timer) { return; }
+    using duration = line_info::clock_type::duration;
+    line_info::time_point deadline = line_info::time_point::max();
+    if (this->_timeout != duration::zero()) { deadline = this->_start_time + this->_timeout; }
+    auto update = [&deadline] (const test& t) {
+        if (t.started() && t.timeout() != duration::zero()) {
+            deadline = std::min(deadline, t.start_time() + t.timeout());
+        }
+    };
+    if (this->_num_test_threads == 0) {
+        if (!this->_tests.empty()) { update(this->_tests.front()); }
+    } else {
+        const auto num_tests = this->_test_graph.size();
+        for (size_t i=0; i<num_tests; ++i) {
+            if (!this->_test_succeeded[i]) { update(this->_test_graph[i]); }
+        }
+    }
+    for (const auto& p : this->_timer_waiters) {
+        deadline = std::min(deadline, p.second.deadline());
+    }
+    ::itimerspec spec{};
+    if (deadline != line_info::time_point::max()) {
+        using namespace std::chrono;
+        // steady clock is CLOCK_MONOTONIC, hence the time points are the same
+        const auto ns = duration_cast<nanoseconds>(deadline.time_since_epoch()).count();
+        spec.it_value.tv_sec = ns / 1000000000L;
+        spec.it_value.tv_nsec = ns % 1000000000L;
+        // zero disarms the timer
+        if (spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0) { spec.it_value.tv_nsec = 1; }
+    }
+    if (::timerfd_settime(this->_timer.fd(), TFD_TIMER_ABSTIME, &spec, nullptr) == -1) {
+        throw std::system_error(errno, std::generic_category());
+    }
+}
+
+void dts::application::build_test_graph() {
+    if (this->_num_test_threads == 0) { return; }
+    while (!this->_tests.empty()) {
+        this->_test_graph.emplace_back(std::move(this->_tests.front()));
+        this->_tests.pop();
+    }
+    const auto num_tests = this->_test_graph.size();
+    std::unordered_map<std::string,size_t> indices;
+    for (size_t i=0; i<num_tests; ++i) {
+        indices.emplace(this->_test_graph[i].description(), i);
+    }
+    this->_test_dependencies.resize(num_tests);
+    for (size_t i=0; i<num_tests; ++i) {
+        for (const auto& d : this->_test_graph[i].dependencies()) {
+            auto result = indices.find(d);
+            if (result == indices.end()) {
+                std::stringstream msg;
+                msg << "unknown dependency \"" << d << "\" of test \""
+                    << this->_test_graph[i].description() << '"';
+                throw std::invalid_argument(msg.str());
+            }
+            this->_test_dependencies[i].emplace_back(result->second);
+        }
+    }
+    this->_test_succeeded.assign(num_tests, false);
+    this->_test_pool.reset(new thread_pool(this->_num_test_threads));
+}
+
+bool dts::application::run_tests_concurrently(lock_type& lock) {
+    using clock_type = ::dts::metrics::clock_type;
+    const auto num_tests = this->_test_graph.size();
+    std::vector<size_t> ready;
+    std::vector<std::string> errors;
+    // vector<bool> is not safe to modify concurrently
+    std::vector<char> succeeded;
+    std::vector<char> pending;
+    bool progress = true;
+    // tests that succeeded unblock their dependents in the next round
+    while (progress) {
+        progress = false;
+        ready.clear();
+        for (size_t i=0; i<num_tests; ++i) {
+            if (this->_test_succeeded[i] || !this->_test_graph[i].triggered()) { continue; }
+            bool all = true;
+            for (auto j : this->_test_dependencies[i]) {
+                if (!this->_test_succeeded[j]) { all = false; break; }
+            }
+            if (all) { ready.emplace_back(i); }
+        }
+        if (ready.empty()) { break; }
+        const auto num_ready = ready.size();
+        errors.assign(num_ready, std::string());
+        succeeded.assign(num_ready, 0);
+        pending.assign(num_ready, 0);
+        // tests read the lines concurrently, hence map spilled lines beforehand
+        this->_lines.map();
+        // tests may launch processes which requires the lock
+        lock.unlock();
+        for (size_t k=0; k<num_ready; ++k) {
+            this->_test_pool->submit([this,k,&ready,&errors,&succeeded,&pending] () {
+                auto& test = this->_test_graph[ready[k]];
+                auto t0 = clock_type::now();
+                test.start(t0);
+                try {
+                    test(*this, this->_lines);
+                    succeeded[k] = 1;
+                } catch (const test_pending&) {
+                    pending[k] = 1;
+                } catch (const std::exception& err) {
+                    errors[k] = err.what();
+                } catch (...) {
+                    errors[k] = "unknown exception";
+                }
+                test.durations().add(clock_type::now()-t0);
+            });
+        }
+        this->_test_pool->wait();
+        lock.lock();
+        for (size_t k=0; k<num_ready; ++k) {
+            const auto i = ready[k];
+            const auto& test = this->_test_graph[i];
+            if (pending[k]) {
+                this->_test_graph[i].evaluated();
+                continue;
+            }
+            std::cerr << "dtest: " << test.description() << '\n';
+            if (succeeded[k]) {
+                this->_test_succeeded[i] = true;
+                this->_metrics.test(test.description(), test.durations());
+                std::cerr << "dtest: Completed successfully.\n";
+                progress = true;
+            } else {
+                this->_test_graph[i].evaluated();
+                this->_test_graph[i].last_error(errors[k]);
+                const auto& what = errors[k];
+                std::cerr << "dtest: " << what;
+                if (what.empty() || what.back() != '\n') {
+                    std::cerr << '\n';
+                }
+            }
+        }
+    }
+    for (size_t i=0; i<num_tests; ++i) {
+        if (!this->_test_succeeded[i]) { return false; }
+    }
+    std::cerr << "dtest: All tests completed successfully.\n";
+    return true;
+}
+
+void dts::application::record(size_t first_line) {
+    const auto num_outputs = this->_output.size();
+    for (; this->_num_recorded_streams<num_outputs; ++this->_num_recorded_streams) {
+        const auto i = this->_num_recorded_streams;
+        const auto& output = this->_output[i];
+        this->_recording.write_stream(i, output.node(), output.prefix());
+    }
+    const auto nlines = this->_lines.size();
+    for (size_t i=first_line; i<nlines; ++i) {
+        const auto line = this->_lines[i];
+        this->_recording.write_line(line.info, line.data, line.size);
+    }
+}
+
+int dts::application::replay() {
+    recording_reader reader(this->_replay_file);
+    reader.read(this->_lines);
+    this->_metrics.line_memory(this->_lines.memory());
+    this->log("replay _ lines from _", this->_lines.size(), this->_replay_file);
+    if (this->_tests.empty()) { return 0; }
+    build_test_graph();
+    lock_type lock(this->_mutex);
+    this->_tests_succeeded = run_tests(lock);
+    if (this->_print_metrics) { report_metrics(); }
+    return this->_tests_succeeded ? 0 : 1;
+}
+
+void dts::application::add_output(std::string prefix, sys::fildes&& in,
+                                   sys::fd_type out, size_t node) {
+    const auto stream = this->_output.size();
+    this->_lines.prefix(stream, prefix);
+    this->_output.emplace_back(std::move(prefix), std::move(in), out, node);
+    auto& output = this->_output.back();
+    output.zero_copy(this->_zero_copy);
+    output.max_line_length(this->_max_line_length);
+    if (this->_shards.empty()) {
+        this->_poller.emplace(output.in().fd(), sys::event::in);
+    } else {
+        // deque does not move the elements, hence the pointer remains valid
+        auto& shard = *this->_shards[stream % this->_shards.size()];
+        lock_type lock(shard.mutex);
+        shard.streams.emplace_back(&output, stream);
+        shard.poller.emplace(output.in().fd(), sys::event::in);
+        shard.poller.notify_one();
+    }
+}
+
+void dts::application::set_pipe_size(const sys::fildes& fd) {
+    if (this->_pipe_size == 0) { return; }
+    if (::fcntl(fd.fd(), F_SETPIPE_SZ, this->_pipe_size) == -1) {
+        log("failed to set pipe size to _: _", this->_pipe_size,
+            std::error_code(errno, std::generic_category()).message());
+    }
+}
+
+void dts::application::write_metrics(std::ostream& out) const {
+    lock_type lock(this->_mutex);
+    out << this->_metrics;
+    if (!this->_tests.empty() && !this->_tests.front().durations().empty()) {
+        const auto& test = this->_tests.front();
+        out << "test_ns \"" << test.description() << "\" " << test.durations() << '\n';
+    }
+    const auto num_outputs = this->_output.size();
+    // the streams that are drained by reader threads are updated with the shard mutex locked
+    std::vector<stream_metrics> snapshot(num_outputs);
+    if (this->_shards.empty()) {
+        for (size_t i=0; i<num_outputs; ++i) { snapshot[i] = this->_output[i].metrics(); }
+    } else {
+        for (auto& shard : this->_shards) {
+            lock_type shard_lock(shard->mutex);
+            for (const auto& pair : shard->streams) {
+                snapshot[pair.second] = pair.first->metrics();
+            }
+        }
+    }
+    for (size_t i=0; i<num_outputs; ++i) {
+        const auto& output = this->_output[i];
+        auto name = output.prefix();
+        while (!name.empty() && (name.back() == ' ' || name.back() == ':')) { name.pop_back(); }
+        out << "stream " << i << ' ' << name << ' ' << snapshot[i] << '\n';
+    }
+    out << "events " << this->_events.size() << '\n';
+    const auto num_rings = this->_event_rings.size();
+    for (size_t i=0; i<num_rings; ++i) {
+        const auto& ring = this->_event_rings[i];
+        out << "event_ring " << i << " node=" << ring.node()
+            << ",dropped=" << ring.dropped() << '\n';
+    }
+}
+
+void dts::application::report_metrics() const {
+    std::stringstream tmp;
+    write_metrics(tmp);
+    std::string line;
+    std::cerr << "dtest: Metrics:\n";
+    while (std::getline(tmp, line)) { std::cerr << "dtest: " << line << '\n'; }
+}
+
+void dts::application::write_stats_file() {
+    this->_stats_time = ::dts::metrics::clock_type::now();
+    // write to temporary file and rename it so that the readers never see partial file
+    std::string tmp_filename = this->_stats_file + ".tmp";
+    {
+        std::ofstream out(tmp_filename);
+        write_metrics(out);
+        if (!out) { log("failed to write stats file _", tmp_filename); return; }
+    }
+    if (std::rename(tmp_filename.data(), this->_stats_file.data()) == -1) {
+        log("failed to rename stats file _", this->_stats_file);
+    }
+}
+
+void dts::test::triggers(string_array regex_strings) {
+    this->_triggers = std::move(regex_strings);
+    if (this->_triggers.empty()) { this->_trigger_regex.reset(); return; }
+    // a single regular expression is faster than the list of them
+    std::string pattern;
+    for (const auto& s : this->_triggers) {
+        if (!pattern.empty()) { pattern += '|'; }
+        pattern += "(?:";
+        pattern += s;
+        pattern += ')';
+    }
+    this->_trigger_regex = std::make_shared<line_regex>(pattern);
+}
+
+void dts::test::screen(const line_array& lines, line_array::size_type first) {
+    if (this->_triggered || !this->_trigger_regex) { return; }
+    const auto& regex = *this->_trigger_regex;
+    const auto n = lines.size();
+    for (auto i=first; i<n; ++i) {
+        if (regex.search(lines[i])) {
+            this->_triggered = true;
+            break;
+        }
+    }
+}
+
+void dts::process_output::count_stall(size_t nread) {
+    if (this->_pipe_capacity == 0) {
+        this->_pipe_capacity = ::fcntl(this->_in.fd(), F_GETPIPE_SZ);
+        if (this->_pipe_capacity <= 0) { this->_pipe_capacity = -1; }
+    }
+    if (this->_pipe_capacity < 0) { return; }
+    int npending = 0;
+    if (::ioctl(this->_in.fd(), FIONREAD, &npending) == -1) { return; }
+    if (size_t(npending) + nread >= size_t(this->_pipe_capacity)) {
+        ++this->_metrics.stalls;
+    }
+}
+
+void dts::process_output::copy(line_array& lines, line_info::stream_type stream) {
+    if (this->_zero_copy) { splice(lines, stream); return; }
     auto& buf = this->_buffer;
-    buf.fill(this->_in);
+    const size_t nread = buf.fill(this->_in);
+    line_info info;
+    info.timestamp = line_info::clock_type::now();
+    info.stream = stream;
+    this->_metrics.bytes += nread;
+    // the buffer is full, check if the pipe was full as well
+    const bool full = buf.position() == buf.size();
+    if (full) { count_stall(nread); }
     buf.flip();
     // limit to newline character
     auto first = buf.data();
@@ -438,24 +1582,167 @@ void dts::process_output::copy(string_array& lines) {
     // print evey line
     auto old_first = first;
     auto prev = first;
+    string_sink sink(this->_forward);
     while (first != last) {
         if (*first == '\n') {
             buf.limit(first-old_first+1);
-            lines.emplace_back();
-            lines.back().reserve(this->_prefix.size() + first-prev);
-            lines.back().append(this->_prefix);
-            lines.back().append(prev, first);
-            this->_out.write(this->_prefix.data(), this->_prefix.size());
-            buf.flush(this->_out);
+            if (this->_truncated) {
+                // the rest of the truncated line is forwarded, but not captured
+                this->_truncated = false;
+            } else {
+                info.sequence = this->_metrics.lines++;
+                lines.emplace_back(make_line(prev, first), info);
+                this->_forward.append(this->_prefix);
+            }
+            buf.flush(sink);
             prev = first+1;
         }
         ++first;
     }
     buf.limit(old_limit);
+    const bool newline = prev != old_first;
+    if (full && !newline && buf.size() >= this->_max_line_length) {
+        // the line does not fit into the buffer of maximum size
+        if (!this->_truncated) {
+            info.sequence = this->_metrics.lines++;
+            lines.emplace_back(make_line(prev, last), info);
+            this->_forward.append(this->_prefix);
+            ++this->_metrics.truncated;
+            this->_truncated = true;
+        }
+        buf.flush(sink);
+    }
     buf.compact();
+    resize_buffer(nread, full, newline);
+    // write all lines with single system call, so that the lines from
+    // different reader threads do not interleave
+    forward_all(this->_out, this->_forward);
+    this->_forward.clear();
     std::clog << std::flush;
 }
 
+void dts::process_output::resize_buffer(size_t nread, bool full, bool newline) {
+    auto& buf = this->_buffer;
+    const auto size = buf.size();
+    if (full) {
+        this->_num_idle = 0;
+        // grow the buffer if the line does not fit or the stream is chatty
+        const auto max_size = newline ?
+            std::min(max_buffer_size, this->_max_line_length) : this->_max_line_length;
+        if (size < max_size) { buf.resize(std::min(size*2, max_size)); }
+    } else if (nread < size/4 && size > this->_min_buffer_size && buf.position() < size/4) {
+        // shrink the buffer of the idle stream
+        constexpr const size_t max_idle = 64;
+        if (++this->_num_idle == max_idle) {
+            this->_num_idle = 0;
+            buf.resize(std::max(size/2, std::max(this->_min_buffer_size, buf.position())));
+        }
+    } else {
+        this->_num_idle = 0;
+    }
+}
+
+void dts::process_output::splice(line_array& lines, line_info::stream_type stream) {
+    if (!this->_tee) {
+        this->_tee.reset(new sys::pipe);
+        this->_raw.resize(this->_buffer.size());
+        // the amount of data that can be duplicated is limited by the capacity
+        // of the intermediate pipe, hence make it not smaller than the source
+        int capacity = ::fcntl(this->_in.fd(), F_GETPIPE_SZ);
+        if (capacity > 0) { ::fcntl(this->_tee->out().fd(), F_SETPIPE_SZ, capacity); }
+    }
+    auto n = ::tee(this->_in.fd(), this->_tee->out().fd(), this->_raw.size(), SPLICE_F_NONBLOCK);
+    if (n == -1) {
+        if (errno == EAGAIN || errno == EINTR) { return; }
+        if (errno == EINVAL) {
+            // the file descriptors are not pipes
+            this->_zero_copy = false;
+            copy(lines, stream);
+            return;
+        }
+        throw std::system_error(errno, std::generic_category());
+    }
+    if (n == 0) { return; }
+    // read exactly the amount of data that was duplicated
+    size_t nread = 0;
+    while (nread != size_t(n)) {
+        auto m = ::read(this->_in.fd(), this->_raw.data()+nread, n-nread);
+        if (m == -1) {
+            if (errno == EINTR || errno == EAGAIN) { continue; }
+            throw std::system_error(errno, std::generic_category());
+        }
+        nread += m;
+    }
+    line_info info;
+    info.timestamp = line_info::clock_type::now();
+    info.stream = stream;
+    this->_metrics.bytes += nread;
+    if (nread == this->_raw.size()) { count_stall(nread); }
+    forward(nread);
+    append_lines(lines, this->_raw.data(), this->_raw.data()+nread, info);
+}
+
+void dts::process_output::forward(size_t n) {
+    auto& tee = *this->_tee;
+    while (n != 0) {
+        auto m = ::splice(tee.in().fd(), nullptr, this->_out.fd(), nullptr, n, SPLICE_F_MOVE);
+        if (m == -1) {
+            if (errno == EINTR) { continue; }
+            if (errno != EINVAL) { throw std::system_error(errno, std::generic_category()); }
+            // the output does not support splicing (e.g. opened in append mode),
+            // forward the rest of the data from user space
+            this->_zero_copy = false;
+            std::string rest(n, '\0');
+            size_t nread = 0;
+            while (nread != n) {
+                auto k = ::read(tee.in().fd(), &rest[nread], n-nread);
+                if (k == -1) {
+                    if (errno == EINTR || errno == EAGAIN) { continue; }
+                    throw std::system_error(errno, std::generic_category());
+                }
+                nread += k;
+            }
+            forward_all(this->_out, rest);
+            return;
+        }
+        n -= m;
+    }
+}
+
+std::string dts::process_output::make_line(const char* first, const char* last) {
+    std::string line;
+    line.reserve(this->_partial.size() + (last-first));
+    line.append(this->_partial);
+    line.append(first, last);
+    this->_partial.clear();
+    return line;
+}
+
+void dts::process_output::append_lines(line_array& lines, const char* first,
+                                       const char* last, line_info info) {
+    auto prev = first;
+    for (; first != last; ++first) {
+        if (*first != '\n') { continue; }
+        if (this->_truncated) {
+            this->_truncated = false;
+            prev = first+1;
+            continue;
+        }
+        info.sequence = this->_metrics.lines++;
+        lines.emplace_back(make_line(prev, first), info);
+        prev = first+1;
+    }
+    if (this->_truncated) { return; }
+    this->_partial.append(prev, last);
+    if (this->_partial.size() > this->_max_line_length) {
+        info.sequence = this->_metrics.lines++;
+        lines.emplace_back(this->_partial.substr(0, this->_max_line_length), info);
+        ++this->_metrics.truncated;
+        this->_partial.clear();
+        this->_truncated = true;
+    }
+}
+
 namespace  {
 
     dts::application* aptr{};
@@ -509,8 +1796,30 @@ namespace  {
         bind_signal(s::hang_up, on_terminate);
     }
 
+    /// Creates tmpfs mount point on the host file system if it does not exist
+    /// and removes it when the tests finish.
+    class mount_point {
+
+    private:
+        std::string _path;
+        bool _created = false;
+
+    public:
+        explicit mount_point(const std::string& path): _path(path) {
+            if (this->_path.empty()) { return; }
+            if (::mkdir(this->_path.data(), 0755) == 0) { this->_created = true; }
+            else if (errno != EEXIST) { throw std::system_error(errno, std::generic_category()); }
+        }
+
+        ~mount_point() { if (this->_created) { ::rmdir(this->_path.data()); } }
+        mount_point(const mount_point&) = delete;
+        mount_point& operator=(const mount_point&) = delete;
+
+    };
+
     int nested_run(dts::application& app) {
         using namespace dts;
+        mount_point tmpfs(app.tmpfs_path());
         sys::pipe pipe;
         pipe.in().unsetf(sys::open_flag::non_blocking);
         pipe.out().unsetf(sys::open_flag::non_blocking);
@@ -545,6 +1854,7 @@ namespace  {
 }
 
 int dts::run(application& app) {
+    if (!app.replay_file().empty()) { return app.replay(); }
     ::aptr = &app;
     parent_signal_handlers();
     auto ret = nested_run(app);
@@ -582,6 +1892,45 @@ void dts::expect_event_sequence(const string_array& lines, const string_array& r
     }
 }
 
+void dts::expect_event_sequence(const line_array& lines, const string_array& regex_strings) {
+    std::vector<line_regex> expressions;
+    for (const auto& s : regex_strings) { expressions.emplace_back(s); }
+    auto first = expressions.begin();
+    auto last = expressions.end();
+    auto first2 = lines.begin();
+    auto last2 = lines.end();
+    while (first != last && first2 != last2) {
+        if (first->match(*first2)) { ++first; }
+        ++first2;
+    }
+    if (first != last) {
+        std::stringstream msg;
+        msg << "unmatched expressions: \n";
+        size_t offset = first - expressions.begin();
+        std::copy(
+            regex_strings.begin() + offset,
+            regex_strings.end(),
+            std::ostream_iterator<std::string>(msg, "\n")
+        );
+        throw std::runtime_error(msg.str());
+    }
+}
+
+void dts::expect_event_count(const line_array& lines,
+                             std::string regex_string,
+                             size_t expected_count) {
+    line_regex expr(regex_string);
+    size_t count = 0;
+    for (const auto& line : lines) {
+        if (expr.match(line)) { ++count; }
+    }
+    if (count != expected_count) {
+        std::stringstream msg;
+        msg << "bad event count: expected=" << expected_count << ",actual=" << count;
+        throw std::runtime_error(msg.str());
+    }
+}
+
 void dts::expect_event_count(const string_array& lines,
                              std::string regex_string,
                              size_t expected_count) {
@@ -596,3 +1945,96 @@ void dts::expect_event_count(const string_array& lines,
         throw std::runtime_error(msg.str());
     }
 }
+
+namespace {
+
+    inline double to_milliseconds(dts::latency_type d) {
+        using milliseconds = std::chrono::duration<double,std::milli>;
+        return std::chrono::duration_cast<milliseconds>(d).count();
+    }
+
+    inline dts::latency_type
+    percentile(std::vector<dts::latency_type>& latencies, double q) {
+        // nearest-rank method
+        size_t rank = size_t(std::ceil(q*latencies.size()));
+        if (rank != 0) { --rank; }
+        std::nth_element(latencies.begin(), latencies.begin()+rank, latencies.end());
+        return latencies[rank];
+    }
+
+}
+
+void dts::expect_latency(const line_array& lines,
+                         std::string start_regex,
+                         std::string end_regex,
+                         latency_type max) {
+    line_regex start_expr(start_regex), end_expr(end_regex);
+    bool started = false, finished = false;
+    line_array::time_point start, end;
+    lines.for_each_ordered([&] (const line& l) {
+        if (finished) { return; }
+        if (!started) {
+            if (start_expr.match(l)) {
+                start = l.info.timestamp;
+                started = true;
+            }
+        } else if (end_expr.match(l)) {
+            end = l.info.timestamp;
+            finished = true;
+        }
+    });
+    if (!finished) {
+        std::stringstream msg;
+        msg << "unmatched expressions: \n";
+        if (!started) { msg << start_regex << '\n'; }
+        msg << end_regex << '\n';
+        throw std::runtime_error(msg.str());
+    }
+    const auto latency = end - start;
+    if (latency > max) {
+        std::stringstream msg;
+        msg << "bad latency: expected<=" << to_milliseconds(max)
+            << "ms,actual=" << to_milliseconds(latency) << "ms";
+        throw std::runtime_error(msg.str());
+    }
+}
+
+void dts::expect_latency_percentiles(const line_array& lines,
+                                     std::string start_regex,
+                                     std::string end_regex,
+                                     const latency_bounds& bounds) {
+    line_regex start_expr(start_regex), end_expr(end_regex);
+    std::unordered_map<std::string,line_array::time_point> started;
+    std::vector<latency_type> latencies;
+    std::cmatch match;
+    lines.for_each_ordered([&] (const line& l) {
+        if (start_expr.match(l, match)) {
+            auto key = match.size() > 1 ? match[1].str() : std::string();
+            started.emplace(std::move(key), l.info.timestamp);
+        } else if (end_expr.match(l, match)) {
+            auto key = match.size() > 1 ? match[1].str() : std::string();
+            auto result = started.find(key);
+            if (result == started.end()) { return; }
+            latencies.emplace_back(l.info.timestamp - result->second);
+            started.erase(result);
+        }
+    });
+    if (latencies.empty() || !started.empty()) {
+        std::stringstream msg;
+        msg << "unmatched events: paired=" << latencies.size()
+            << ",unpaired=" << started.size() << '\n'
+            << start_regex << '\n' << end_regex << '\n';
+        throw std::runtime_error(msg.str());
+    }
+    const auto p50 = percentile(latencies, 0.50);
+    const auto p99 = percentile(latencies, 0.99);
+    const auto max = *std::max_element(latencies.begin(), latencies.end());
+    if (p50 > bounds.p50 || p99 > bounds.p99 || max > bounds.max) {
+        std::stringstream msg;
+        msg << "bad latency: count=" << latencies.size()
+            << ",p50=" << to_milliseconds(p50) << "ms"
+            << ",p99=" << to_milliseconds(p99) << "ms"
+            << ",max=" << to_milliseconds(max) << "ms";
+        throw std::runtime_error(msg.str());
+    }
+}
@@ -3,15 +3,22 @@
 
 #include <atomic>
 #include <chrono>
+#include <deque>
 #include <functional>
 #include <future>
+#include <limits>
+#include <list>
+#include <memory>
 #include <mutex>
 #include <queue>
+#include <regex>
+#include <stdexcept>
 #include <thread>
 
 #include <unistdx/base/byte_buffer>
 #include <unistdx/base/log_message>
 #include <unistdx/base/simple_lock>
+#include <unistdx/io/pipe>
 #include <unistdx/io/poller>
 #include <unistdx/ipc/argstream>
 #include <unistdx/ipc/process_group>
@@ -19,23 +26,45 @@
 #include <dtest/cluster.hh>
 #include <dtest/cluster_node.hh>
 #include <dtest/cluster_node_bitmap.hh>
+#include <dtest/event_output.hh>
+#include <dtest/event_ring.hh>
 #include <dtest/exit_code.hh>
+#include <dtest/extract.hh>
+#include <dtest/line_array.hh>
+#include <dtest/metrics.hh>
+#include <dtest/packet_capture.hh>
+#include <dtest/perf_counters.hh>
+#include <dtest/recording.hh>
+#include <dtest/thread_pool.hh>
+#include <dtest/waiter.hh>
 
 namespace dts {
 
-    using string_array = std::vector<std::string>;
-
     class application;
 
     class process_output {
 
     public:
+        /// The buffer of chatty streams grows up to this size.
+        static constexpr const size_t max_buffer_size = 4096*16;
 
     private:
         sys::byte_buffer _buffer;
         std::string _prefix;
         sys::fildes _in;
         sys::fd_type _out;
+        size_t _node = 0;
+        stream_metrics _metrics;
+        int _pipe_capacity = 0;
+        bool _zero_copy = false;
+        std::unique_ptr<sys::pipe> _tee;
+        std::vector<char> _raw;
+        std::string _partial;
+        std::string _forward;
+        size_t _min_buffer_size = 4096;
+        size_t _max_line_length = 1024*1024;
+        size_t _num_idle = 0;
+        bool _truncated = false;
 
     public:
 
@@ -44,28 +73,107 @@ namespace dts {
             const std::string& prefix,
             sys::fildes&& in,
             sys::fd_type out,
+            size_t node=0,
             size_t size=4096
         ):
-        _buffer{size}, _prefix(prefix), _in(std::move(in)), _out(out) {}
+        _buffer{size}, _prefix(prefix), _in(std::move(in)), _out(out), _node(node),
+        _min_buffer_size(size) {}
+
+        void copy(line_array& lines, line_info::stream_type stream);
+
+        inline bool zero_copy() const noexcept { return this->_zero_copy; }
+
+        /**
+        \brief Forward the output with splice(2) instead of write(2).
+        \details The data is duplicated with tee(2) into intermediate pipe
+        and spliced to the output. The lines are still read into user space
+        for matching, but are not copied back, hence the forwarded output
+        is not prefixed with node names. Falls back to the ordinary copy
+        if splicing is not supported; the incomplete line is kept.
+        */
+        inline void zero_copy(bool rhs) noexcept { this->_zero_copy = rhs; }
 
-        void copy(string_array& lines);
+        inline size_t max_line_length() const noexcept { return this->_max_line_length; }
 
+        /**
+        \brief Lines that are longer than \p rhs bytes are truncated.
+        \details The buffer grows until it can hold the longest line,
+        hence the maximum line length also limits the size of the buffer.
+        */
+        inline void max_line_length(size_t rhs) noexcept { this->_max_line_length = rhs; }
+
+        inline size_t buffer_size() const noexcept { return this->_buffer.size(); }
         inline const sys::fildes& in() const { return this->_in; }
         inline const sys::fd_type& out() const { return this->_out; }
+        inline const std::string& prefix() const noexcept { return this->_prefix; }
+        inline size_t node() const noexcept { return this->_node; }
+        inline const stream_metrics& metrics() const noexcept { return this->_metrics; }
+
+    private:
+        void count_stall(size_t nread);
+        void resize_buffer(size_t nread, bool full, bool newline);
+        void splice(line_array& lines, line_info::stream_type stream);
+        void append_lines(line_array& lines, const char* first, const char* last,
+                          line_info info);
+        /// Prepend the incomplete line that was read with splice (if any).
+        std::string make_line(const char* first, const char* last);
+        void forward(size_t n);
 
     };
 
+    /**
+    \brief Reader thread that drains a subset of the streams.
+    \details Each shard has its own poller, and the lines are passed to
+    the main thread in batches that are merged by timestamp.
+    */
+    struct reader_shard {
+        using mutex_type = std::recursive_mutex;
+        using stream_array = std::vector<std::pair<process_output*,line_info::stream_type>>;
+        sys::event_poller poller;
+        std::thread thread;
+        mutex_type mutex;
+        /// Streams that are read by this shard (protected by the mutex).
+        stream_array streams;
+        std::mutex ready_mutex;
+        /// Lines that were read, but not merged (protected by ready mutex).
+        std::vector<line_array> ready{1};
+    };
+
+    /**
+    \brief Thrown by the test that waits for asynchronous computation (e.g. coroutine).
+    \details The test is neither reported as failed nor evaluated again until
+    its trigger flag is set.
+    */
+    class test_pending: public std::exception {
+    public:
+        inline const char* what() const noexcept override { return "test is pending"; }
+    };
+
     class test {
 
     public:
-        using test_function = std::function<void(application&, const string_array&)>;
+        using test_function = std::function<void(application&, const line_array&)>;
+        using trigger_flag_ptr = std::shared_ptr<std::atomic<bool>>;
 
     private:
         std::string _description;
         test_function _function;
+        histogram _durations;
+        string_array _dependencies;
+        string_array _triggers;
+        std::shared_ptr<line_regex> _trigger_regex;
+        bool _triggered = true;
+        trigger_flag_ptr _trigger_flag;
+        line_info::clock_type::duration _timeout{};
+        line_info::time_point _start_time{};
+        bool _started = false;
+        std::string _last_error;
 
     public:
         inline explicit test(std::string d, test_function f): _description(d), _function(f) {}
+
+        inline explicit test(std::string d, test_function f, string_array dependencies):
+        _description(d), _function(f), _dependencies(std::move(dependencies)) {}
         test() = default;
         ~test() = default;
         test(const test&) = default;
@@ -83,10 +191,77 @@ namespace dts {
             this->_function = rhs;
         }
 
-        inline void operator()(application& a, const string_array& lines) {
+        inline void operator()(application& a, const line_array& lines) {
             this->_function(a, lines);
         }
 
+        /// Descriptions of the tests that have to succeed before this test is evaluated
+        /// (used only when the tests are evaluated concurrently).
+        inline const string_array& dependencies() const noexcept { return this->_dependencies; }
+        inline void dependencies(string_array rhs) { this->_dependencies = std::move(rhs); }
+
+        inline const string_array& triggers() const noexcept { return this->_triggers; }
+
+        /**
+        \brief Evaluate the test only when new lines match any of the \p regex_strings.
+        \details The test is always evaluated for the first time. By default
+        (no patterns) the test is evaluated after every poller wakeup.
+        */
+        void triggers(string_array regex_strings);
+
+        /// Check new lines starting from \p first against trigger patterns.
+        void screen(const line_array& lines, line_array::size_type first);
+
+        /// Whether the outcome of the test might have changed since the last evaluation.
+        inline bool triggered() const noexcept {
+            if (this->_trigger_flag) { return this->_trigger_flag->load(); }
+            return !this->_trigger_regex || this->_triggered;
+        }
+
+        /**
+        \brief Evaluate the test only when \p rhs is set.
+        \details The flag is set and cleared by the test function and whoever
+        completes its asynchronous computation, the patterns are ignored.
+        */
+        inline void trigger_flag(trigger_flag_ptr rhs) noexcept {
+            this->_trigger_flag = std::move(rhs);
+        }
+
+        /// Wait for the next matching line before the test is evaluated again.
+        inline void evaluated() noexcept { this->_triggered = false; }
+
+        inline line_info::clock_type::duration timeout() const noexcept {
+            return this->_timeout;
+        }
+
+        /// Fail the test if it does not succeed in \p rhs after it can be evaluated,
+        /// i.e. after the previous tests or its dependencies succeeded (zero means no timeout).
+        inline void timeout(line_info::clock_type::duration rhs) noexcept {
+            this->_timeout = rhs;
+        }
+
+        /// Remember the time when the test can be evaluated for the first time.
+        inline void start(line_info::time_point t) noexcept {
+            if (!this->_started) { this->_start_time = t, this->_started = true; }
+        }
+
+        inline bool started() const noexcept { return this->_started; }
+        inline line_info::time_point start_time() const noexcept { return this->_start_time; }
+
+        /// Whether the test has timeout and it expired at time point \p now.
+        inline bool expired(line_info::time_point now) const noexcept {
+            return this->_started && this->_timeout != line_info::clock_type::duration::zero() &&
+                now-this->_start_time >= this->_timeout;
+        }
+
+        /// The error message of the last failed evaluation.
+        inline const std::string& last_error() const noexcept { return this->_last_error; }
+        inline void last_error(std::string rhs) { this->_last_error = std::move(rhs); }
+
+        /// Durations of every evaluation of the test.
+        inline histogram& durations() noexcept { return this->_durations; }
+        inline const histogram& durations() const noexcept { return this->_durations; }
+
     };
 
     class application {
@@ -107,7 +282,36 @@ namespace dts {
         std::vector<cluster_node_bitmap> _where;
         sys::process_group _child_processes;
         std::vector<size_t> _child_process_nodes;
-        std::vector<process_output> _output;
+        /// Indices of \link _arguments \endlink that each child process runs.
+        std::vector<size_t> _child_process_arguments;
+        /// Whether the child process was reaped by node restart.
+        std::vector<char> _child_process_reaped;
+        /// Performance counters of each child process (empty if disabled).
+        std::vector<::dts::perf_counters> _child_process_counters;
+        bool _perf_counters = false;
+        /// Thread that reaps the processes of the restarted nodes and launches them again.
+        struct restart_thread {
+            std::thread thread;
+            /// Set under the lock when the thread is about to return.
+            bool finished = false;
+        };
+        /// The list does not invalidate the references to the flags.
+        std::list<restart_thread> _restart_threads;
+        std::vector<std::pair<size_t,line_waiter>> _line_waiters;
+        std::vector<std::pair<size_t,process_waiter>> _process_waiters;
+        std::vector<std::pair<size_t,timer_waiter>> _timer_waiters;
+        size_t _num_waiters = 0;
+        std::deque<process_output> _output;
+        std::vector<std::unique_ptr<reader_shard>> _shards;
+        std::vector<line_array> _batches;
+        size_t _num_readers = 1;
+        std::vector<event_output> _event_output;
+        std::vector<event_ring> _event_rings;
+        size_t _event_ring_size = 0;
+        size_t _event_ring_watermark = 0;
+        bool _zero_copy = false;
+        size_t _max_line_length = 1024*1024;
+        int _pipe_size = 0;
         sys::event_poller _poller;
         std::thread _output_thread;
         exit_code_type _exit_code = exit_code_type::all;
@@ -116,12 +320,36 @@ namespace dts {
         bool _will_restart = false;
         std::atomic<bool> _stopped{false};
         test_queue _tests;
-        string_array _lines;
+        size_t _num_test_threads = 0;
+        std::unique_ptr<thread_pool> _test_pool;
+        std::vector<test> _test_graph;
+        std::vector<std::vector<size_t>> _test_dependencies;
+        std::vector<bool> _test_succeeded;
+        line_info::clock_type::duration _timeout{};
+        line_info::time_point _start_time{};
+        sys::fildes _timer;
+        bool _timed_out = false;
+        line_array _lines;
+        event_array _events;
         bool _no_tests = false;
         bool _tests_succeeded = false;
         std::promise<void> _tests_completed;
         mutable mutex_type _mutex;
         bool _user_namespaces = true;
+        ::dts::metrics _metrics;
+        bool _print_metrics = false;
+        std::string _stats_file;
+        ::dts::metrics::clock_type::time_point _stats_time{};
+        ::dts::metrics::clock_type::duration _stats_interval = std::chrono::seconds(1);
+        std::string _record_file;
+        std::string _replay_file;
+        recording_writer _recording;
+        size_t _num_recorded_streams = 0;
+        bool _capture_traffic = false;
+        std::string _capture_file;
+        packet_capture _packet_capture;
+        std::string _tmpfs_path;
+        size_t _tmpfs_size = 0;
 
     public:
 
@@ -134,6 +362,9 @@ namespace dts {
         void validate();
         int wait();
 
+        /// Run the tests against the recorded output without launching any processes.
+        int replay();
+
         inline void send(sys::signal s) { this->_child_processes.send(s); }
         inline void terminate() { this->send(sys::signal::terminate); }
         inline bool stopped() { return this->_stopped; }
@@ -149,11 +380,170 @@ namespace dts {
         inline duration execution_delay() const noexcept { return this->_execution_delay; }
         inline bool user_namespaces() const noexcept { return this->_user_namespaces; }
         inline void user_namespaces(bool rhs) noexcept { this->_user_namespaces = rhs; }
+        inline const ::dts::metrics& metrics() const noexcept { return this->_metrics; }
+        inline bool print_metrics() const noexcept { return this->_print_metrics; }
+        inline void print_metrics(bool rhs) noexcept { this->_print_metrics = rhs; }
+        inline const std::string& stats_file() const noexcept { return this->_stats_file; }
+        inline void stats_file(const std::string& rhs) { this->_stats_file = rhs; }
+        inline const line_array& lines() const noexcept { return this->_lines; }
+        inline size_t max_line_length() const noexcept { return this->_max_line_length; }
+        /// Truncate captured lines that are longer than \p rhs bytes.
+        inline void max_line_length(size_t rhs) noexcept { this->_max_line_length = rhs; }
+        inline int pipe_size() const noexcept { return this->_pipe_size; }
+        /// Set capacity of stdout/stderr pipes of child processes via F_SETPIPE_SZ
+        /// (zero means the default capacity).
+        inline void pipe_size(int rhs) noexcept { this->_pipe_size = rhs; }
+        inline line_info::clock_type::duration timeout() const noexcept {
+            return this->_timeout;
+        }
+
+        /// Fail the tests and terminate the processes if the tests do not
+        /// succeed in \p rhs after the launch (zero means no timeout).
+        inline void timeout(line_info::clock_type::duration rhs) noexcept {
+            this->_timeout = rhs;
+        }
+
+        inline bool timed_out() const noexcept { return this->_timed_out; }
+
+        inline size_t num_test_threads() const noexcept { return this->_num_test_threads; }
+        /**
+        \brief Evaluate independent tests concurrently in \p rhs threads.
+        \details By default (zero threads) the tests are evaluated sequentially
+        in the order they were added. Otherwise the test is evaluated as soon as
+        all of its dependencies succeeded.
+        */
+        inline void num_test_threads(size_t rhs) noexcept { this->_num_test_threads = rhs; }
+        inline size_t num_readers() const noexcept { return this->_num_readers; }
+        /// Read the streams in \p rhs threads (the streams are distributed between
+        /// the threads in round-robin fashion).
+        inline void num_readers(size_t rhs) noexcept { this->_num_readers = rhs; }
+        inline bool zero_copy() const noexcept { return this->_zero_copy; }
+        /// Forward the output of child processes via splice(2) without node prefixes.
+        inline void zero_copy(bool rhs) noexcept { this->_zero_copy = rhs; }
+        /// Binary events emitted by the processes via event channel.
+        inline const event_array& events() const noexcept { return this->_events; }
+
+        /// \return the copy of the events that is made with the application mutex locked
+        /// (the events are appended by the output thread)
+        inline event_array copy_events() const {
+            lock_type lock(this->_mutex);
+            return this->_events;
+        }
+        inline size_t event_ring_size() const noexcept { return this->_event_ring_size; }
+        /// Pass events via shared memory ring of \p rhs bytes instead of the pipe
+        /// (zero disables the rings).
+        inline void event_ring_size(size_t rhs) noexcept { this->_event_ring_size = rhs; }
+        inline size_t event_ring_watermark() const noexcept { return this->_event_ring_watermark; }
+        /// Wake up dtest only when the ring contains at least \p rhs bytes.
+        inline void event_ring_watermark(size_t rhs) noexcept { this->_event_ring_watermark = rhs; }
+        /// Maximum amount of memory for captured lines, older lines are moved
+        /// to temporary file (zero means unlimited).
+        inline void max_line_memory(size_t rhs) noexcept { this->_lines.max_memory(rhs); }
+        /// Keep only lines that match \p regex_string when moving them to temporary file.
+        inline void retain_lines(const std::string& regex_string) { this->_lines.filter(regex_string); }
+        inline const std::string& record_file() const noexcept { return this->_record_file; }
+        inline void record_file(const std::string& rhs) { this->_record_file = rhs; }
+        inline const std::string& replay_file() const noexcept { return this->_replay_file; }
+        inline void replay_file(const std::string& rhs) { this->_replay_file = rhs; }
+        inline bool perf_counters() const noexcept { return this->_perf_counters; }
+        /// Count hardware and software events of every launched process.
+        inline void perf_counters(bool rhs) noexcept { this->_perf_counters = rhs; }
+        inline bool capture_traffic() const noexcept { return this->_capture_traffic; }
+        /// Capture the frames that pass through the cluster bridge and count them per node.
+        inline void capture_traffic(bool rhs) noexcept { this->_capture_traffic = rhs; }
+        inline const std::string& capture_file() const noexcept { return this->_capture_file; }
+        /// Write the captured frames to pcapng file (empty name disables the file).
+        inline void capture_file(const std::string& rhs) { this->_capture_file = rhs; }
+        inline const std::string& tmpfs_path() const noexcept { return this->_tmpfs_path; }
+        /**
+        \brief Mount private tmpfs at \p rhs on every node (empty path disables tmpfs).
+        \details Processes whose working directory is under \p rhs start in the root directory.
+        The directory is created if it does not exist and removed when the tests finish.
+        */
+        inline void tmpfs_path(const std::string& rhs) { this->_tmpfs_path = rhs; }
+        inline size_t tmpfs_size() const noexcept { return this->_tmpfs_size; }
+        /// Maximum size of each node's tmpfs in bytes (zero means the kernel default).
+        inline void tmpfs_size(size_t rhs) noexcept { this->_tmpfs_size = rhs; }
 
         void add_process(cluster_node_bitmap nodes, sys::argstream args);
         void run_process(cluster_node_bitmap where, sys::argstream args);
         void kill_process(cluster_node_bitmap where, sys::signal signal);
 
+        /**
+        \brief Restart every process running on the specified nodes.
+        \details Sends \p signal to the processes, reaps them in a separate
+        thread, waits for \p delay and launches the same commands again in
+        the existing namespaces of the nodes. Returns immediately.
+        */
+        void restart_node(cluster_node_bitmap where, sys::signal signal, duration delay);
+
+        /// Wait for the lines from any node.
+        static constexpr const size_t any_node = std::numeric_limits<size_t>::max();
+        /// Sum the counters of all processes.
+        static constexpr const size_t any_process = std::numeric_limits<size_t>::max();
+
+        /**
+        \brief Sum of the performance counters of the processes launched
+        by \p process_no-th command (the index of --exec) on the node \p node_no.
+        \details The counts of the descendants of the processes are included
+        when the descendants terminate. The counters of restarted processes
+        are summed up.
+        */
+        perf_values counters(size_t node_no=any_node, size_t process_no=any_process) const;
+
+        /**
+        \brief The number of frames and bytes that the node \p node_no
+        (or all nodes) sent and received via the cluster bridge.
+        \details The frames are visible after the kernel retires the ring block
+        (when the block is full or in 10 milliseconds).
+        */
+        traffic_summary traffic(size_t node_no=any_node);
+
+        /**
+        \brief Call \p callback once when the lines that match \p regex_strings
+        (in order) are captured.
+        \details The lines are matched starting from the line with position \p first
+        (\link line_array::position \endlink), and the lines that were already
+        captured are matched immediately.
+        The callback is called with the application mutex locked.
+        \return waiter identifier for \link cancel_waiter \endlink
+        */
+        size_t wait_for_lines(const string_array& regex_strings, size_t node_no,
+                              line_array::size_type first, line_waiter::callback_type callback);
+
+        /**
+        \brief Call \p callback once when all processes running on \p where exit.
+        \return waiter identifier for \link cancel_waiter \endlink
+        */
+        size_t wait_for_exit(cluster_node_bitmap where, process_waiter::callback_type callback);
+
+        /**
+        \brief Call \p callback once when \p deadline is reached.
+        \details The deadline is checked when the output thread wakes up,
+        and the timer is armed to wake it up at the nearest deadline.
+        \return waiter identifier for \link cancel_waiter \endlink
+        */
+        size_t wait_until(line_info::time_point deadline, timer_waiter::callback_type callback);
+
+        /// Remove the waiter that is no longer needed (e.g. timed out).
+        void cancel_waiter(size_t id);
+
+        /**
+        \brief Extract numeric \p fields from the capture groups
+        of \p regex_string in the captured lines.
+        \details Locks the application mutex, hence can be called from the tests
+        and from other threads.
+        */
+        extracted_columns extract(const std::string& regex_string, const field_array& fields,
+                                  size_t node_no=any_node) const;
+
+        /// Wake up output thread to re-evaluate the tests.
+        inline void wakeup() { this->_poller.notify_one(); }
+
+        /// Write self-metrics of dtest (the same format as in stats file).
+        /// Locks the application mutex and the mutex of every reader shard.
+        void write_metrics(std::ostream& out) const;
+
         inline void add_process(size_t node_no, sys::argstream args) {
             add_process(cluster_node_bitmap(cluster().size(), {node_no}), std::move(args));
         }
@@ -166,8 +556,15 @@ namespace dts {
             kill_process(cluster_node_bitmap(cluster().size(), {node_no}), signal);
         }
 
+        inline void restart_node(size_t node_no, sys::signal signal, duration delay) {
+            restart_node(cluster_node_bitmap(cluster().size(), {node_no}), signal, delay);
+        }
+
         inline void add_test(test t) { this->_tests.emplace(std::move(t)); }
 
+        /// The most recently added test.
+        inline test& last_test() noexcept { return this->_tests.back(); }
+
         template <class ... Args>
         inline void emplace_test(Args&& ... args) {
             this->_tests.emplace(std::forward<Args>(args)...);
@@ -182,8 +579,33 @@ namespace dts {
     private:
 
         int accumulate_return_value();
+        void launch_process(size_t node_no, size_t process_no);
+        sys::fildes make_mount_namespace() const;
+        void open_perf_counters(sys::pid_type pid);
+        void report_perf_counters() const;
+        void report_traffic() const;
+
+        inline bool reaped(size_t i) const noexcept {
+            return i < this->_child_process_reaped.size() && this->_child_process_reaped[i];
+        }
+
         void process_events();
-        bool run_tests();
+        void read_shard(reader_shard& shard);
+        void merge_shards();
+        bool run_tests(lock_type& lock);
+        bool run_tests_concurrently(lock_type& lock);
+        void screen_tests(line_array::size_type first);
+        void notify_waiters();
+        void start_tests(line_info::time_point now);
+        void drain_events();
+        void check_deadlines();
+        void arm_timer();
+        void build_test_graph();
+        void write_stats_file();
+        void report_metrics() const;
+        void record(size_t first_line);
+        void add_output(std::string prefix, sys::fildes&& in, sys::fd_type out, size_t node);
+        void set_pipe_size(const sys::fildes& fd);
 
     };
 
@@ -199,6 +621,49 @@ namespace dts {
                             std::string regex_string,
                             size_t expected_count);
 
+    /// Check event sequence in all lines including the ones spilled to the temporary file.
+    void expect_event_sequence(const line_array& lines, const string_array& regex_strings);
+
+    inline void expect_event(const line_array& lines, std::string regex_string) {
+        expect_event_sequence(lines, {std::move(regex_string)});
+    }
+
+    /// Count events in all lines including the ones spilled to the temporary file.
+    void expect_event_count(const line_array& lines,
+                            std::string regex_string,
+                            size_t expected_count);
+
+    using latency_type = line_info::clock_type::duration;
+
+    /**
+    \brief Check the time between two events.
+    \details The first line that matches \p end_regex after the first line
+    that matches \p start_regex (in timestamp order) should be captured
+    not later than \p max after the start line.
+    */
+    void expect_latency(const line_array& lines,
+                        std::string start_regex,
+                        std::string end_regex,
+                        latency_type max);
+
+    /// Upper bounds for latency percentiles.
+    struct latency_bounds {
+        latency_type p50 = latency_type::max();
+        latency_type p99 = latency_type::max();
+        latency_type max = latency_type::max();
+    };
+
+    /**
+    \brief Check the distribution of latencies between paired events.
+    \details Start and end events are paired by the first capture group of
+    the corresponding regular expressions (e.g. request id). The test fails
+    until every start event has matching end event.
+    */
+    void expect_latency_percentiles(const line_array& lines,
+                                    std::string start_regex,
+                                    std::string end_regex,
+                                    const latency_bounds& bounds);
+
 }
 
 #endif // vim:filetype=cpp
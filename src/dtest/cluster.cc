@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <cstdlib>
 #include <iomanip>
 #include <sstream>
 #include <stdexcept>
@@ -36,3 +37,17 @@ dts::cluster_node& dts::cluster::node(std::string name) {
     }
     return *result;
 }
+
+void dts::cluster::read_environment() {
+    if (const char* s = std::getenv("DTEST_NAME")) { this->_name = s; }
+    if (const char* s = std::getenv("DTEST_NETWORK")) {
+        std::stringstream tmp(s);
+        tmp >> this->_network;
+        if (!tmp) { throw std::invalid_argument("bad DTEST_NETWORK"); }
+    }
+    if (const char* s = std::getenv("DTEST_PEER_NETWORK")) {
+        std::stringstream tmp(s);
+        tmp >> this->_peer_network;
+        if (!tmp) { throw std::invalid_argument("bad DTEST_PEER_NETWORK"); }
+    }
+}
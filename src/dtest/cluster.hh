@@ -28,6 +28,8 @@ namespace dts {
         inline size_t size() const { return this->_nodes.size(); }
         inline void network(address_type rhs) { this->_network = rhs; }
         inline void peer_network(address_type rhs) { this->_peer_network = rhs; }
+        inline const address_type& network() const noexcept { return this->_network; }
+        inline const address_type& peer_network() const noexcept { return this->_peer_network; }
         inline const sys::bridge_interface& bridge() const noexcept { return this->_bridge; }
         inline void bridge(sys::bridge_interface&& rhs) { this->_bridge = std::move(rhs); }
         inline const std::vector<cluster_node>& nodes() const noexcept { return this->_nodes; }
@@ -35,6 +37,14 @@ namespace dts {
         void generate_nodes(size_t n);
         cluster_node& node(std::string name);
 
+        /**
+        \brief Take default name and networks from the environment.
+        \details Reads DTEST_NAME, DTEST_NETWORK and DTEST_PEER_NETWORK
+        environment variables (set by dtest-scenarios for each scenario).
+        Explicitly specified name and networks override these defaults.
+        */
+        void read_environment();
+
     };
 
 }
@@ -23,6 +23,7 @@ namespace dts {
         sys::veth_interface _veth;
         sys::fildes _network_namespace;
         sys::fildes _hostname_namespace;
+        sys::fildes _mount_namespace;
 
     public:
         inline const std::string& name() const { return this->_name; }
@@ -51,6 +52,15 @@ namespace dts {
             this->_hostname_namespace = std::move(rhs);
         }
 
+        /// Mount namespace with node's private tmpfs (not opened if tmpfs is disabled).
+        inline const sys::fildes& mount_namespace() const {
+            return this->_mount_namespace;
+        }
+
+        inline void mount_namespace(sys::fildes&& rhs) {
+            this->_mount_namespace = std::move(rhs);
+        }
+
         template <class Function>
         void run(Function func) {
             const auto old_network_namespace = sys::this_process::get_namespace("net");
@@ -0,0 +1,334 @@
+#ifndef DTEST_COROUTINE_HH
+#define DTEST_COROUTINE_HH
+
+#if __cplusplus < 202002L || !defined(__cpp_impl_coroutine)
+#error "dtest/coroutine.hh requires C++20 coroutines (compile with -std=c++20)"
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <dtest/application.hh>
+
+/**
+\file
+\brief Optional C++20 coroutine interface to write tests as scenarios.
+\details The library itself is built with C++11, this header is used only
+by the tests that are compiled with C++20. A scenario is a coroutine that
+takes \link dts::coroutine_context \endlink and awaits the lines, process
+exits and timers. The coroutine is resumed by the output thread only when
+the awaited condition is met, the lines are never re-scanned.
+\code
+dts::coroutine crash_and_recovery(dts::coroutine_context& ctx) {
+    co_await ctx.event("^x1: started$");
+    ctx->kill_process(0, sys::signal::kill);
+    co_await ctx.exited(0);
+    co_await ctx.sleep(std::chrono::milliseconds(100));
+    ctx->run_process(0, sys::argstream{"app"});
+    dts::string_array expected{"^x1: started$", "^x1: joined$"};
+    co_await ctx.sequence(std::move(expected));
+}
+app.add_test(dts::make_coroutine_test("crash and recovery", crash_and_recovery));
+\endcode
+*/
+
+namespace dts {
+
+    /// Coroutine that is resumed by the output thread.
+    class coroutine {
+
+    public:
+        struct promise_type {
+            std::exception_ptr error;
+            /// Set when the coroutine returns (the test may be evaluated in another thread).
+            std::atomic<bool> finished{false};
+            /// Trigger flag of the test that is set when the coroutine returns.
+            test::trigger_flag_ptr trigger;
+
+            inline coroutine get_return_object() noexcept {
+                return coroutine(handle_type::from_promise(*this));
+            }
+            inline std::suspend_always initial_suspend() const noexcept { return {}; }
+            inline std::suspend_always final_suspend() const noexcept { return {}; }
+            inline void return_void() noexcept { finish(); }
+
+            inline void unhandled_exception() noexcept {
+                this->error = std::current_exception();
+                finish();
+            }
+
+            inline void finish() noexcept {
+                this->finished = true;
+                if (this->trigger) { this->trigger->store(true); }
+            }
+        };
+
+        using handle_type = std::coroutine_handle<promise_type>;
+
+    private:
+        handle_type _handle;
+
+    public:
+        inline explicit coroutine(handle_type h) noexcept: _handle(h) {}
+        inline ~coroutine() noexcept { if (this->_handle) { this->_handle.destroy(); } }
+        inline coroutine(coroutine&& rhs) noexcept: _handle(std::exchange(rhs._handle, {})) {}
+        inline coroutine& operator=(coroutine&& rhs) noexcept {
+            std::swap(this->_handle, rhs._handle);
+            return *this;
+        }
+        coroutine(const coroutine&) = delete;
+        coroutine& operator=(const coroutine&) = delete;
+
+        /// Set \p flag when the coroutine returns.
+        inline void trigger(test::trigger_flag_ptr flag) noexcept {
+            this->_handle.promise().trigger = std::move(flag);
+        }
+
+        /// Run the coroutine until the first suspension point.
+        inline void start() { this->_handle.resume(); }
+
+        inline bool done() const noexcept { return this->_handle.promise().finished; }
+
+        /// Rethrow the exception that the finished coroutine did not catch.
+        inline void rethrow() const {
+            if (auto error = this->_handle.promise().error) { std::rethrow_exception(error); }
+        }
+
+    };
+
+    namespace bits {
+
+        /**
+        \brief Common part of all awaitables.
+        \details The waiter callback may be called before await_suspend returns
+        (the condition is already met) or from another thread, hence the state
+        transition decides who resumes the coroutine. The callback refers to
+        the awaitable, hence the waiter is cancelled if the awaitable is destroyed
+        before the callback is called (e.g. with the coroutine frame).
+        */
+        template <class Result>
+        class waiter_awaitable {
+
+        private:
+            enum state_type { registering, suspended, completed };
+
+        private:
+            std::atomic<int> _state{registering};
+            std::coroutine_handle<> _handle;
+            application* _application = nullptr;
+            size_t _waiter = 0;
+
+        protected:
+            Result _result{};
+
+        public:
+            waiter_awaitable() = default;
+
+            inline ~waiter_awaitable() {
+                if (this->_application && this->_state.load() != completed) {
+                    this->_application->cancel_waiter(this->_waiter);
+                }
+            }
+
+            waiter_awaitable(const waiter_awaitable&) = delete;
+            waiter_awaitable& operator=(const waiter_awaitable&) = delete;
+
+            inline bool await_ready() const noexcept { return false; }
+            inline Result await_resume() { return std::move(this->_result); }
+
+        protected:
+
+            /// Remember the waiter to cancel it in the destructor.
+            inline void registered(application& app, size_t id) noexcept {
+                this->_application = &app;
+                this->_waiter = id;
+            }
+
+            /// \return false if the coroutine has to be resumed immediately
+            inline bool suspend(std::coroutine_handle<> h) noexcept {
+                this->_handle = h;
+                int expected = registering;
+                return this->_state.compare_exchange_strong(expected, suspended);
+            }
+
+            inline void complete(Result result) {
+                this->_result = std::move(result);
+                if (this->_state.exchange(completed) == suspended) { this->_handle.resume(); }
+            }
+
+        };
+
+    }
+
+    class coroutine_context;
+
+    /// Resolves to the first line that matches the regular expression.
+    class line_awaitable: public bits::waiter_awaitable<string_array> {
+
+    private:
+        coroutine_context& _context;
+        string_array _regex_strings;
+        size_t _node;
+
+    public:
+        inline line_awaitable(coroutine_context& context, string_array regex_strings,
+                              size_t node) noexcept:
+        _context(context), _regex_strings(std::move(regex_strings)), _node(node) {}
+
+        bool await_suspend(std::coroutine_handle<> h);
+
+    };
+
+    /// Resolves when the deadline is reached.
+    class timer_awaitable: public bits::waiter_awaitable<bool> {
+
+    private:
+        application& _application;
+        line_info::time_point _deadline;
+
+    public:
+        inline timer_awaitable(application& app, line_info::time_point deadline) noexcept:
+        _application(app), _deadline(deadline) {}
+
+        inline bool await_suspend(std::coroutine_handle<> h) {
+            registered(this->_application, this->_application.wait_until(
+                this->_deadline, [this] () { this->complete(true); }));
+            return this->suspend(h);
+        }
+
+        inline void await_resume() const noexcept {}
+
+    };
+
+    /// Resolves to exit codes (negative signal numbers) of the processes.
+    class exit_awaitable: public bits::waiter_awaitable<process_waiter::status_array> {
+
+    private:
+        application& _application;
+        cluster_node_bitmap _nodes;
+
+    public:
+        inline exit_awaitable(application& app, cluster_node_bitmap nodes) noexcept:
+        _application(app), _nodes(std::move(nodes)) {}
+
+        inline bool await_suspend(std::coroutine_handle<> h) {
+            registered(this->_application, this->_application.wait_for_exit(
+                this->_nodes, [this] (const process_waiter::status_array& statuses) {
+                    this->complete(statuses);
+                }));
+            return this->suspend(h);
+        }
+
+    };
+
+    /**
+    \brief The argument of the scenario coroutine.
+    \details Awaited lines are matched after the line that resolved
+    the previous line awaitable of the same scenario. The context stores
+    the position of the next line (\link line_array::position \endlink),
+    since line indices change when the lines are discarded.
+    */
+    class coroutine_context {
+
+    public:
+        using size_type = line_array::size_type;
+
+    private:
+        application& _application;
+        /// The position of the first line that the next awaitable matches.
+        size_type _position = 0;
+
+    public:
+        inline explicit coroutine_context(application& app) noexcept: _application(app) {}
+
+        inline application& app() noexcept { return this->_application; }
+        inline application* operator->() noexcept { return &this->_application; }
+
+        inline size_type position() const noexcept { return this->_position; }
+        inline void position(size_type rhs) noexcept { this->_position = rhs; }
+
+        /// Await the line that matches \p regex_string and return it.
+        inline auto event(std::string regex_string, size_t node=application::any_node) {
+            struct awaitable: public line_awaitable {
+                using line_awaitable::line_awaitable;
+                inline std::string await_resume() { return std::move(this->_result.front()); }
+            };
+            return awaitable(*this, string_array{std::move(regex_string)}, node);
+        }
+
+        /// Await the lines that match \p regex_strings in order and return them.
+        inline line_awaitable
+        sequence(string_array regex_strings, size_t node=application::any_node) {
+            return line_awaitable(*this, std::move(regex_strings), node);
+        }
+
+        template <class Rep, class Period> inline timer_awaitable
+        sleep(std::chrono::duration<Rep,Period> d) {
+            using namespace std::chrono;
+            return timer_awaitable(this->_application, line_info::clock_type::now() +
+                                   duration_cast<line_info::clock_type::duration>(d));
+        }
+
+        inline exit_awaitable exited(cluster_node_bitmap nodes) {
+            return exit_awaitable(this->_application, std::move(nodes));
+        }
+
+        inline exit_awaitable exited(size_t node_no) {
+            return exited(cluster_node_bitmap(this->_application.cluster().size(), {node_no}));
+        }
+
+    };
+
+    inline bool line_awaitable::await_suspend(std::coroutine_handle<> h) {
+        registered(this->_context.app(), this->_context->wait_for_lines(
+            this->_regex_strings, this->_node, this->_context.position(),
+            [this] (const string_array& lines, line_array::size_type last) {
+                this->_context.position(last+1);
+                this->complete(lines);
+            }));
+        return this->suspend(h);
+    }
+
+    /**
+    \brief Create the test that runs scenario coroutine \p function.
+    \details The coroutine is started when the test is evaluated for the first time.
+    After that the test is evaluated again only when the coroutine returns.
+    The test succeeds when the coroutine returns and fails when it throws.
+    */
+    template <class Function> inline test
+    make_coroutine_test(std::string description, Function function) {
+        struct state_type {
+            Function function;
+            std::unique_ptr<coroutine_context> context;
+            std::optional<coroutine> task;
+            test::trigger_flag_ptr trigger;
+        };
+        auto trigger = std::make_shared<std::atomic<bool>>(true);
+        auto state = std::make_shared<state_type>(
+            state_type{std::move(function), {}, {}, trigger});
+        test result(std::move(description), [state] (application& app, const line_array&) {
+            // cleared before the coroutine is checked, hence the completion is never missed
+            state->trigger->store(false);
+            if (!state->task) {
+                state->context = std::make_unique<coroutine_context>(app);
+                state->task.emplace(state->function(*state->context));
+                state->task->trigger(state->trigger);
+                state->task->start();
+            }
+            if (!state->task->done()) { throw test_pending(); }
+            state->task->rethrow();
+        });
+        result.trigger_flag(std::move(trigger));
+        return result;
+    }
+
+}
+
+#endif // vim:filetype=cpp
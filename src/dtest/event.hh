@@ -0,0 +1,217 @@
+#ifndef DTEST_EVENT_HH
+#define DTEST_EVENT_HH
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+/**
+\file
+\brief Header-only library to emit events from the application under test.
+\details Dtest passes the file descriptor of the event channel to every process
+via DTEST_EVENT_FD environment variable. Each event is a record that consists
+of 32-bit length (the size of identifier and payload), 32-bit identifier and
+the payload. Records that are not larger than PIPE_BUF are written atomically.
+
+When dtest is run with event rings enabled, DTEST_EVENT_RING environment
+variable contains memory and wakeup file descriptors of the shared memory ring.
+In this case the events are written to the ring without system calls, and the
+reader is woken up only when it sleeps and the ring is filled up to the watermark
+or the process exits. Dtest also drains the rings when the event pipe is closed.
+The ring has single producer: the events should be emitted from one thread
+or the calls should be serialised by the application.
+
+When the application is not run by dtest, the events are silently discarded.
+*/
+
+namespace dts {
+
+    namespace events {
+
+        /// Maximum payload size that guarantees atomic write.
+        constexpr std::uint32_t max_payload_size = 4096 - 2*sizeof(std::uint32_t);
+
+        /// Records in the ring are aligned to eight bytes, hence record header never wraps.
+        constexpr std::uint64_t ring_alignment = 8;
+
+        inline constexpr std::uint64_t
+        ring_record_size(std::uint32_t length) noexcept {
+            return (sizeof(length) + length + ring_alignment - 1) & ~(ring_alignment - 1);
+        }
+
+        /// Shared memory layout of the event ring. The data follows the header.
+        struct ring_header {
+            static constexpr const std::uint64_t magic_value = 0x474e495254534544UL;
+            std::uint64_t magic;
+            /// The size of the data in bytes (power of two).
+            std::uint64_t capacity;
+            /// Wake up the reader when the ring contains at least this number of bytes.
+            std::uint64_t watermark;
+            /// Write position (modified by the producer only).
+            alignas(64) std::atomic<std::uint64_t> head;
+            /// The number of events that did not fit into the ring.
+            std::atomic<std::uint64_t> dropped;
+            /// Read position (modified by the consumer only).
+            alignas(64) std::atomic<std::uint64_t> tail;
+            /// Whether the consumer waits for the wakeup.
+            std::atomic<std::uint32_t> waiting;
+
+            inline char* data() noexcept { return reinterpret_cast<char*>(this + 1); }
+            inline const char* data() const noexcept {
+                return reinterpret_cast<const char*>(this + 1);
+            }
+        };
+
+        static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "lock-free atomics are required");
+
+        /// Single producer of the events in the shared memory ring.
+        class ring_writer {
+
+        private:
+            ring_header* _ring = nullptr;
+            int _wakeup = -1;
+
+        public:
+            inline ring_writer(ring_header* ring, int wakeup) noexcept:
+            _ring(ring), _wakeup(wakeup) {}
+
+            ring_writer() = default;
+
+            inline explicit operator bool() const noexcept { return this->_ring != nullptr; }
+            inline bool operator!() const noexcept { return !this->operator bool(); }
+
+            inline bool
+            write(std::uint32_t id, const void* payload, std::uint32_t size) noexcept {
+                auto& ring = *this->_ring;
+                const std::uint32_t length = sizeof(id) + size;
+                const auto n = ring_record_size(length);
+                auto head = ring.head.load(std::memory_order_relaxed);
+                const auto tail = ring.tail.load(std::memory_order_acquire);
+                if (ring.capacity - (head - tail) < n) {
+                    ring.dropped.fetch_add(1, std::memory_order_relaxed);
+                    wakeup();
+                    return false;
+                }
+                const auto mask = ring.capacity - 1;
+                auto data = ring.data();
+                std::memcpy(data + (head & mask), &length, sizeof(length));
+                std::memcpy(data + ((head + sizeof(length)) & mask), &id, sizeof(id));
+                if (size != 0) {
+                    const auto offset = (head + sizeof(length) + sizeof(id)) & mask;
+                    const auto n1 = std::min<std::uint64_t>(size, ring.capacity - offset);
+                    std::memcpy(data + offset, payload, n1);
+                    std::memcpy(data, static_cast<const char*>(payload) + n1, size - n1);
+                }
+                head += n;
+                ring.head.store(head, std::memory_order_seq_cst);
+                if (head - tail >= ring.watermark) { wakeup(); }
+                return true;
+            }
+
+            /// Wake up the reader if the ring is not empty regardless of the watermark.
+            inline void
+            flush() noexcept {
+                auto& ring = *this->_ring;
+                if (ring.head.load(std::memory_order_seq_cst) !=
+                    ring.tail.load(std::memory_order_acquire)) {
+                    wakeup();
+                }
+            }
+
+        private:
+
+            inline void
+            wakeup() noexcept {
+                auto& ring = *this->_ring;
+                if (!ring.waiting.load(std::memory_order_seq_cst) ||
+                    !ring.waiting.exchange(0, std::memory_order_seq_cst)) {
+                    return;
+                }
+                const std::uint64_t one = 1;
+                while (::write(this->_wakeup, &one, sizeof(one)) == -1 && errno == EINTR) {}
+            }
+
+        };
+
+        struct channel_type {
+            int fd = -1;
+            ring_writer ring;
+        };
+
+        inline ring_writer
+        open_ring(const char* s) noexcept {
+            char* end = nullptr;
+            const int memory = std::strtol(s, &end, 10);
+            if (*end != ',') { return {}; }
+            const int wakeup = std::strtol(end+1, nullptr, 10);
+            struct ::stat st;
+            if (::fstat(memory, &st) == -1 || size_t(st.st_size) < sizeof(ring_header)) {
+                return {};
+            }
+            void* ptr = ::mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE,
+                               MAP_SHARED, memory, 0);
+            if (ptr == MAP_FAILED) { return {}; }
+            auto ring = static_cast<ring_header*>(ptr);
+            if (ring->magic != ring_header::magic_value) {
+                ::munmap(ptr, st.st_size);
+                return {};
+            }
+            return ring_writer(ring, wakeup);
+        }
+
+        inline channel_type&
+        channel() noexcept {
+            static channel_type c = [] () {
+                channel_type c;
+                if (const char* s = std::getenv("DTEST_EVENT_FD")) { c.fd = std::atoi(s); }
+                if (const char* s = std::getenv("DTEST_EVENT_RING")) {
+                    c.ring = open_ring(s);
+                    // events below the watermark are delivered when the process exits
+                    if (c.ring) { std::atexit([] () { channel().ring.flush(); }); }
+                }
+                return c;
+            }();
+            return c;
+        }
+
+        /// Write event record to the pipe with file descriptor \p fd.
+        inline bool
+        write(int fd, std::uint32_t id, const void* payload, std::uint32_t size) noexcept {
+            if (size > max_payload_size) { return false; }
+            char buffer[4096];
+            const std::uint32_t length = sizeof(id) + size;
+            std::memcpy(buffer, &length, sizeof(length));
+            std::memcpy(buffer+sizeof(length), &id, sizeof(id));
+            if (size != 0) { std::memcpy(buffer+sizeof(length)+sizeof(id), payload, size); }
+            const ::ssize_t n = sizeof(length) + length;
+            ::ssize_t ret;
+            while ((ret = ::write(fd, buffer, n)) == -1 && errno == EINTR) {}
+            return ret == n;
+        }
+
+        /// Emit event with identifier \p id and optional \p payload.
+        inline bool
+        emit(std::uint32_t id, const void* payload=nullptr, std::uint32_t size=0) noexcept {
+            auto& c = channel();
+            if (c.ring) { return size <= max_payload_size && c.ring.write(id, payload, size); }
+            if (c.fd == -1) { return false; }
+            return write(c.fd, id, payload, size);
+        }
+
+        template <class T> inline bool
+        emit(std::uint32_t id, const T& payload) noexcept {
+            return emit(id, &payload, sizeof(T));
+        }
+
+    }
+
+}
+
+#endif // vim:filetype=cpp
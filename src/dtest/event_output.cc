@@ -0,0 +1,86 @@
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+
+#include <dtest/event_output.hh>
+
+namespace {
+
+    void print(std::ostream& out, const dts::event_pattern& pattern) {
+        out << "id=" << pattern.id;
+        if (pattern.node != dts::event_pattern::any_node) { out << ",node=" << pattern.node; }
+        out << '\n';
+    }
+
+}
+
+constexpr const std::int64_t dts::event_pattern::any_node;
+
+void dts::event_output::copy(event_array& events) {
+    const auto timestamp = line_info::clock_type::now();
+    while (true) {
+        auto n = ::read(this->_in.fd(), this->_buffer.data() + this->_size,
+                        this->_buffer.size() - this->_size);
+        if (n == -1) {
+            if (errno == EINTR) { continue; }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) { break; }
+            throw std::system_error(errno, std::generic_category());
+        }
+        if (n == 0) { break; }
+        if (this->_discard) { continue; }
+        this->_size += n;
+        const char* first = this->_buffer.data();
+        const char* last = first + this->_size;
+        std::uint32_t length = 0, id = 0;
+        while (size_t(last-first) >= sizeof(length)+sizeof(id)) {
+            std::memcpy(&length, first, sizeof(length));
+            if (length < sizeof(id) || length > this->_buffer.size()-sizeof(length)) {
+                throw std::invalid_argument("bad event record");
+            }
+            if (size_t(last-first) < sizeof(length)+length) { break; }
+            std::memcpy(&id, first+sizeof(length), sizeof(id));
+            events.emplace_back();
+            auto& e = events.back();
+            e.timestamp = timestamp;
+            e.node = this->_node;
+            e.id = id;
+            e.payload.assign(first+sizeof(length)+sizeof(id), length-sizeof(id));
+            first += sizeof(length) + length;
+        }
+        this->_size = last-first;
+        std::memmove(this->_buffer.data(), first, this->_size);
+    }
+}
+
+void dts::expect_event_sequence(const event_array& events, const event_pattern_array& patterns) {
+    auto first = patterns.begin();
+    auto last = patterns.end();
+    auto first2 = events.begin();
+    auto last2 = events.end();
+    while (first != last && first2 != last2) {
+        if (first->matches(*first2)) { ++first; }
+        ++first2;
+    }
+    if (first != last) {
+        std::stringstream msg;
+        msg << "unmatched events: \n";
+        for (; first != last; ++first) { print(msg, *first); }
+        throw std::runtime_error(msg.str());
+    }
+}
+
+void dts::expect_event_count(const event_array& events,
+                             const event_pattern& pattern,
+                             size_t expected_count) {
+    size_t count = 0;
+    for (const auto& e : events) {
+        if (pattern.matches(e)) { ++count; }
+    }
+    if (count != expected_count) {
+        std::stringstream msg;
+        msg << "bad event count: expected=" << expected_count << ",actual=" << count;
+        throw std::runtime_error(msg.str());
+    }
+}
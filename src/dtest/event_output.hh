@@ -0,0 +1,78 @@
+#ifndef DTEST_EVENT_OUTPUT_HH
+#define DTEST_EVENT_OUTPUT_HH
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <unistdx/io/fildes>
+
+#include <dtest/line_array.hh>
+
+namespace dts {
+
+    /// Binary event emitted by the application via dts::events::emit.
+    struct event {
+        using id_type = std::uint32_t;
+        line_info::time_point timestamp;
+        std::uint32_t node = 0;
+        id_type id = 0;
+        std::string payload;
+    };
+
+    using event_array = std::vector<event>;
+
+    /// Reads length-prefixed binary records from the event channel of one process.
+    class event_output {
+
+    private:
+        std::vector<char> _buffer;
+        size_t _size = 0;
+        sys::fildes _in;
+        std::uint32_t _node = 0;
+        bool _discard = false;
+
+    public:
+
+        inline explicit
+        event_output(sys::fildes&& in, std::uint32_t node, size_t size=4096*16):
+        _buffer(size), _in(std::move(in)), _node(node) {}
+
+        /**
+        \brief Read all available records and append them to \p events.
+        \throw std::invalid_argument if the record is malformed
+        */
+        void copy(event_array& events);
+
+        /// Read and discard all subsequent data (e.g. after malformed record).
+        inline void discard() noexcept { this->_discard = true; this->_size = 0; }
+
+        inline const sys::fildes& in() const { return this->_in; }
+        inline std::uint32_t node() const noexcept { return this->_node; }
+
+    };
+
+    /// Event pattern that matches event identifier and optionally the node.
+    struct event_pattern {
+        static constexpr const std::int64_t any_node = -1;
+        event::id_type id = 0;
+        std::int64_t node = any_node;
+        inline event_pattern(event::id_type i, std::int64_t n=any_node): id(i), node(n) {}
+        inline bool matches(const event& e) const noexcept {
+            return e.id == this->id && (this->node == any_node || e.node == this->node);
+        }
+    };
+
+    using event_pattern_array = std::vector<event_pattern>;
+
+    /// Check that the events occurred in the specified order.
+    void expect_event_sequence(const event_array& events, const event_pattern_array& patterns);
+
+    /// Check that the event occurred exactly \p expected_count times.
+    void expect_event_count(const event_array& events,
+                            const event_pattern& pattern,
+                            size_t expected_count);
+
+}
+
+#endif // vim:filetype=cpp
@@ -0,0 +1,145 @@
+#include <fcntl.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#include <dtest/event_ring.hh>
+
+namespace {
+
+    inline int check(int ret) {
+        if (ret == -1) { throw std::system_error(errno, std::generic_category()); }
+        return ret;
+    }
+
+    inline size_t round_up_to_power_of_two(size_t n) {
+        size_t result = dts::events::ring_alignment;
+        while (result < n) { result <<= 1; }
+        return result;
+    }
+
+}
+
+constexpr const std::uint64_t dts::events::ring_header::magic_value;
+
+dts::event_ring::event_ring(size_t capacity, std::uint32_t node, size_t watermark):
+_memory(check(::memfd_create("dtest-events", MFD_CLOEXEC))),
+_wakeup(check(::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK))),
+_node(node) {
+    capacity = round_up_to_power_of_two(capacity);
+    this->_size = sizeof(events::ring_header) + capacity;
+    check(::ftruncate(this->_memory.fd(), this->_size));
+    void* ptr = ::mmap(nullptr, this->_size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED, this->_memory.fd(), 0);
+    if (ptr == MAP_FAILED) { throw std::system_error(errno, std::generic_category()); }
+    this->_ring = new (ptr) events::ring_header;
+    this->_ring->capacity = capacity;
+    this->_ring->watermark = watermark;
+    this->_ring->head = 0;
+    this->_ring->dropped = 0;
+    this->_ring->tail = 0;
+    this->_ring->waiting = 1;
+    this->_ring->magic = events::ring_header::magic_value;
+}
+
+dts::event_ring::~event_ring() { unmap(); }
+
+dts::event_ring::event_ring(event_ring&& rhs) noexcept:
+_memory(std::move(rhs._memory)),
+_wakeup(std::move(rhs._wakeup)),
+_ring(rhs._ring),
+_size(rhs._size),
+_node(rhs._node),
+_discard(rhs._discard) {
+    rhs._ring = nullptr;
+    rhs._size = 0;
+}
+
+auto dts::event_ring::operator=(event_ring&& rhs) noexcept -> event_ring& {
+    unmap();
+    this->_memory = std::move(rhs._memory);
+    this->_wakeup = std::move(rhs._wakeup);
+    std::swap(this->_ring, rhs._ring);
+    std::swap(this->_size, rhs._size);
+    this->_node = rhs._node;
+    this->_discard = rhs._discard;
+    return *this;
+}
+
+void dts::event_ring::unmap() {
+    if (this->_ring) { ::munmap(this->_ring, this->_size); }
+    this->_ring = nullptr;
+    this->_size = 0;
+}
+
+std::string dts::event_ring::environment() const {
+    return std::to_string(this->_memory.fd()) + ',' + std::to_string(this->_wakeup.fd());
+}
+
+void dts::event_ring::inherit() const {
+    // fcntl(2) is async-signal-safe, unlike setenv(3)
+    check(::fcntl(this->_memory.fd(), F_SETFD, 0));
+    check(::fcntl(this->_wakeup.fd(), F_SETFD, 0));
+}
+
+void dts::event_ring::copy(event_array& events) {
+    std::uint64_t count = 0;
+    while (::read(this->_wakeup.fd(), &count, sizeof(count)) == -1 && errno == EINTR) {}
+    auto& ring = *this->_ring;
+    drain(events);
+    // the producer checks the flag after updating the head, hence either
+    // the producer sees the flag or we see the new head
+    ring.waiting.store(1, std::memory_order_seq_cst);
+    if (ring.head.load(std::memory_order_seq_cst) !=
+        ring.tail.load(std::memory_order_relaxed)) {
+        drain(events);
+    }
+}
+
+void dts::event_ring::discard() noexcept {
+    this->_discard = true;
+    auto& ring = *this->_ring;
+    ring.tail.store(ring.head.load(std::memory_order_acquire), std::memory_order_release);
+}
+
+void dts::event_ring::drain(event_array& events) {
+    auto& ring = *this->_ring;
+    auto tail = ring.tail.load(std::memory_order_relaxed);
+    const auto head = ring.head.load(std::memory_order_acquire);
+    if (tail == head) { return; }
+    if (this->_discard) { ring.tail.store(head, std::memory_order_release); return; }
+    const auto timestamp = line_info::clock_type::now();
+    const auto mask = ring.capacity - 1;
+    const auto data = ring.data();
+    std::uint32_t length = 0, id = 0;
+    while (tail != head) {
+        std::memcpy(&length, data + (tail & mask), sizeof(length));
+        if (length < sizeof(id) || events::ring_record_size(length) > head - tail) {
+            throw std::invalid_argument("bad event record");
+        }
+        std::memcpy(&id, data + ((tail + sizeof(length)) & mask), sizeof(id));
+        events.emplace_back();
+        auto& e = events.back();
+        e.timestamp = timestamp;
+        e.node = this->_node;
+        e.id = id;
+        const size_t size = length - sizeof(id);
+        e.payload.resize(size);
+        if (size != 0) {
+            const auto offset = (tail + sizeof(length) + sizeof(id)) & mask;
+            const auto n1 = std::min<std::uint64_t>(size, ring.capacity - offset);
+            std::memcpy(&e.payload[0], data + offset, n1);
+            std::memcpy(&e.payload[n1], data, size - n1);
+        }
+        tail += events::ring_record_size(length);
+    }
+    ring.tail.store(tail, std::memory_order_release);
+}
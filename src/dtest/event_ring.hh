@@ -0,0 +1,74 @@
+#ifndef DTEST_EVENT_RING_HH
+#define DTEST_EVENT_RING_HH
+
+#include <cstdint>
+#include <string>
+
+#include <unistdx/io/fildes>
+
+#include <dtest/event.hh>
+#include <dtest/event_output.hh>
+
+namespace dts {
+
+    /**
+    \brief Shared memory ring that receives events from one process.
+    \details The ring is backed by memfd and the reader is woken up via eventfd.
+    Both file descriptors are passed to the child process in DTEST_EVENT_RING
+    environment variable, and the child maps the ring on the first event.
+    */
+    class event_ring {
+
+    private:
+        sys::fildes _memory;
+        sys::fildes _wakeup;
+        events::ring_header* _ring = nullptr;
+        size_t _size = 0;
+        std::uint32_t _node = 0;
+        bool _discard = false;
+
+    public:
+
+        /// \param capacity the size of the ring in bytes (rounded up to the power of two)
+        /// \param watermark wake up the reader when this number of bytes is in the ring
+        event_ring(size_t capacity, std::uint32_t node, size_t watermark=0);
+        ~event_ring();
+        event_ring(const event_ring&) = delete;
+        event_ring& operator=(const event_ring&) = delete;
+        event_ring(event_ring&& rhs) noexcept;
+        event_ring& operator=(event_ring&& rhs) noexcept;
+
+        /**
+        \brief Read all events from the ring and append them to \p events.
+        \throw std::invalid_argument if the record is malformed
+        */
+        void copy(event_array& events);
+
+        /// Discard all subsequent records (e.g. after malformed record).
+        void discard() noexcept;
+
+        /// The value of DTEST_EVENT_RING environment variable of the child process.
+        std::string environment() const;
+
+        /// Clear close-on-exec flag of the descriptors in the child process.
+        void inherit() const;
+
+        /// Eventfd that becomes readable when the ring needs to be drained.
+        inline const sys::fildes& in() const noexcept { return this->_wakeup; }
+        inline events::ring_header* header() noexcept { return this->_ring; }
+        inline std::uint32_t node() const noexcept { return this->_node; }
+
+        /// The number of events that did not fit into the ring.
+        inline std::uint64_t dropped() const noexcept {
+            return this->_ring->dropped.load(std::memory_order_relaxed);
+        }
+
+    private:
+        void drain(event_array& events);
+        void unmap();
+
+    };
+
+}
+
+#endif // vim:filetype=cpp
@@ -0,0 +1,71 @@
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+
+#include <dtest/extract.hh>
+
+constexpr const dts::extracted_columns::node_type dts::extracted_columns::unknown_node;
+
+namespace {
+
+    [[noreturn]] void throw_bad_field(const dts::field& f, const std::string& value) {
+        std::stringstream msg;
+        msg << "field \"" << f.name << "\" is not a number: \"" << value << '"';
+        throw std::invalid_argument(msg.str());
+    }
+
+}
+
+dts::extracted_columns dts::extract(const line_array& lines, const line_regex& expr,
+                                    const field_array& fields,
+                                    const std::vector<size_t>& stream_nodes,
+                                    size_t node_no) {
+    using seconds = std::chrono::duration<double>;
+    const auto any_node = std::numeric_limits<size_t>::max();
+    const auto num_fields = fields.size();
+    if (num_fields > expr.mark_count()) {
+        throw std::invalid_argument("more fields than capture groups");
+    }
+    extracted_columns result;
+    for (const auto& f : fields) {
+        if (f.type == field::types::integer) {
+            result.columns.emplace_back(result.integers.size());
+            result.integers.emplace_back();
+        } else {
+            result.columns.emplace_back(result.reals.size());
+            result.reals.emplace_back();
+        }
+    }
+    std::cmatch match;
+    // reused buffer for null-terminated capture groups
+    std::string value;
+    for (const auto& line : lines) {
+        const auto stream = line.info.stream;
+        const auto node = stream < stream_nodes.size() ? stream_nodes[stream] : any_node;
+        if (node_no != any_node && node != node_no) { continue; }
+        if (!expr.search(line, match)) { continue; }
+        for (size_t i=0; i<num_fields; ++i) {
+            const auto& f = fields[i];
+            const auto& group = match[i+1];
+            value.assign(group.first, group.second);
+            char* end = nullptr;
+            errno = 0;
+            if (f.type == field::types::integer) {
+                const auto x = std::strtoll(value.data(), &end, 10);
+                if (value.empty() || *end != 0 || errno != 0) { throw_bad_field(f, value); }
+                result.integers[result.columns[i]].emplace_back(x);
+            } else {
+                const auto x = std::strtod(value.data(), &end);
+                if (value.empty() || *end != 0 || errno == ERANGE) { throw_bad_field(f, value); }
+                result.reals[result.columns[i]].emplace_back(x);
+            }
+        }
+        result.nodes.emplace_back(node == any_node ? extracted_columns::unknown_node :
+                                  extracted_columns::node_type(node));
+        const auto t = line.info.timestamp.time_since_epoch();
+        result.timestamps.emplace_back(std::chrono::duration_cast<seconds>(t).count());
+    }
+    return result;
+}
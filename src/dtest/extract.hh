@@ -0,0 +1,65 @@
+#ifndef DTEST_EXTRACT_HH
+#define DTEST_EXTRACT_HH
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <dtest/line_array.hh>
+
+namespace dts {
+
+    /**
+    \brief Capture group of the regular expression that is parsed as a number.
+    \details The name is only a label: the i-th field refers to the capture group i+1.
+    */
+    struct field {
+        enum class types { integer, real };
+        std::string name;
+        types type = types::real;
+        inline field(std::string n, types t): name(std::move(n)), type(t) {}
+        field() = default;
+    };
+
+    using field_array = std::vector<field>;
+
+    /**
+    \brief Columns of the values extracted from the lines that match the same
+    regular expression.
+    \details The i-th element of every column belongs to the same line.
+    Each field is stored either in integer or in real column depending on its type.
+    */
+    struct extracted_columns {
+        using node_type = std::int32_t;
+        using integer_type = std::int64_t;
+        using real_type = double;
+        /// The node of the line that was not produced by a cluster node (e.g. replayed).
+        static constexpr const node_type unknown_node = -1;
+        std::vector<node_type> nodes;
+        /// Capture timestamps in seconds (the same clock as in \link line_info \endlink).
+        std::vector<real_type> timestamps;
+        std::vector<std::vector<integer_type>> integers;
+        std::vector<std::vector<real_type>> reals;
+        /// The index of the field in either integer or real columns.
+        std::vector<size_t> columns;
+        inline size_t size() const noexcept { return this->nodes.size(); }
+    };
+
+    /**
+    \brief Extract \p fields from capture groups of \p expr in every line
+    that contains the match.
+    \details The fields correspond to the capture groups 1..n in order.
+    \param[in] stream_nodes maps stream index to node index
+    \param[in] node_no extract only the lines of this node (or all lines
+    if the node is std::numeric_limits<size_t>::max())
+    \throw std::invalid_argument if the capture group is not a number
+    */
+    extracted_columns extract(const line_array& lines, const line_regex& expr,
+                              const field_array& fields,
+                              const std::vector<size_t>& stream_nodes,
+                              size_t node_no=std::numeric_limits<size_t>::max());
+
+}
+
+#endif // vim:filetype=cpp
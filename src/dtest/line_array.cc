@@ -0,0 +1,408 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+#include <system_error>
+
+#include <dtest/line_array.hh>
+
+namespace {
+
+    struct spilled_line_header {
+        std::uint64_t timestamp;
+        std::uint64_t sequence;
+        std::uint32_t stream;
+        std::uint32_t size;
+    };
+
+    constexpr size_t alignment = 8;
+
+    inline size_t record_size(size_t line_size) {
+        const auto n = sizeof(spilled_line_header) + line_size;
+        return n + (alignment - n%alignment)%alignment;
+    }
+
+    int make_temporary_file() {
+        const char* dir = std::getenv("TMPDIR");
+        std::string path = dir ? dir : "/tmp";
+        path += "/dtest-lines-XXXXXX";
+        int fd = ::mkostemp(&path[0], O_CLOEXEC);
+        if (fd == -1) { throw std::system_error(errno, std::generic_category()); }
+        // the file is removed automatically when closed
+        ::unlink(path.data());
+        return fd;
+    }
+
+    void write_all(int fd, const char* data, size_t size) {
+        while (size != 0) {
+            auto n = ::write(fd, data, size);
+            if (n == -1) {
+                if (errno == EINTR) { continue; }
+                throw std::system_error(errno, std::generic_category());
+            }
+            data += n, size -= n;
+        }
+    }
+
+    /// \return true if the expression has alternation outside of groups and brackets
+    bool has_top_level_alternation(const std::string& s) {
+        int depth = 0;
+        bool brackets = false;
+        const auto n = s.size();
+        for (size_t i=0; i<n; ++i) {
+            const char ch = s[i];
+            if (ch == '\\') { ++i; }
+            else if (brackets) { if (ch == ']') { brackets = false; } }
+            else if (ch == '[') { brackets = true; }
+            else if (ch == '(') { ++depth; }
+            else if (ch == ')') { if (depth != 0) { --depth; } }
+            else if (ch == '|' && depth == 0) { return true; }
+        }
+        return false;
+    }
+
+}
+
+dts::line_array::~line_array() { close(); }
+
+dts::line_regex::line_regex(const std::string& regex_string): _expression(regex_string) {
+    // split the literal prefix "^name: " that does not contain special characters
+    if (regex_string.empty() || regex_string.front() != '^') { return; }
+    // the prefix applies only to the first alternative
+    if (has_top_level_alternation(regex_string)) { return; }
+    const auto n = regex_string.size();
+    size_t i = 1;
+    while (i != n && (std::isalnum(static_cast<unsigned char>(regex_string[i])) ||
+                      regex_string[i] == '_' || regex_string[i] == '-')) {
+        ++i;
+    }
+    if (i == 1 || i+1 >= n || regex_string[i] != ':' || regex_string[i+1] != ' ') { return; }
+    i += 2;
+    // the space is not the subject of the quantifier
+    if (i != n && std::strchr("*+?{", regex_string[i])) { return; }
+    this->_prefix = regex_string.substr(1, i-1);
+    this->_rest = std::regex("^" + regex_string.substr(i));
+}
+
+template <class Function>
+bool dts::line_regex::apply(const line& l, Function f) const {
+    if (l.prefix_size == 0) { return f(l.begin(), l.end(), this->_expression); }
+    if (!this->_prefix.empty()) {
+        return this->_prefix.size() == l.prefix_size &&
+            this->_prefix.compare(0, l.prefix_size, l.prefix, l.prefix_size) == 0 &&
+            f(l.begin(), l.end(), this->_rest);
+    }
+    auto& buf = this->_buffer;
+    buf.assign(l.prefix, l.prefix_size);
+    buf.append(l.data, l.size);
+    return f(buf.data(), buf.data()+buf.size(), this->_expression);
+}
+
+bool dts::line_regex::match(const line& l) const {
+    return apply(l, [] (const char* first, const char* last, const std::regex& expr) {
+        return std::regex_match(first, last, expr);
+    });
+}
+
+bool dts::line_regex::match(const line& l, std::cmatch& result) const {
+    return apply(l, [&result] (const char* first, const char* last, const std::regex& expr) {
+        return std::regex_match(first, last, result, expr);
+    });
+}
+
+bool dts::line_regex::search(const line& l) const {
+    return apply(l, [] (const char* first, const char* last, const std::regex& expr) {
+        return std::regex_search(first, last, expr);
+    });
+}
+
+bool dts::line_regex::search(const line& l, std::cmatch& result) const {
+    return apply(l, [&result] (const char* first, const char* last, const std::regex& expr) {
+        return std::regex_search(first, last, result, expr);
+    });
+}
+
+dts::line_array::line_array(line_array&& rhs) noexcept:
+_lines(std::move(rhs._lines)),
+_info(std::move(rhs._info)),
+_prefixes(std::move(rhs._prefixes)),
+_rendered(std::move(rhs._rendered)),
+_num_spilled(rhs._num_spilled),
+_num_appended(rhs._num_appended),
+_memory(rhs._memory),
+_max_memory(rhs._max_memory),
+_filter(std::move(rhs._filter)),
+_offsets(std::move(rhs._offsets)),
+_positions(std::move(rhs._positions)),
+_spill_fd(rhs._spill_fd),
+_spill_size(rhs._spill_size),
+_map(rhs._map),
+_map_size(rhs._map_size),
+_sorted(rhs._sorted) {
+    rhs._spill_fd = -1;
+    rhs._map = nullptr;
+    rhs._map_size = 0;
+}
+
+auto dts::line_array::operator=(line_array&& rhs) noexcept -> line_array& {
+    close();
+    this->_lines = std::move(rhs._lines);
+    this->_info = std::move(rhs._info);
+    this->_prefixes = std::move(rhs._prefixes);
+    this->_rendered = std::move(rhs._rendered);
+    this->_num_spilled = rhs._num_spilled;
+    this->_num_appended = rhs._num_appended;
+    this->_memory = rhs._memory;
+    this->_max_memory = rhs._max_memory;
+    this->_filter = std::move(rhs._filter);
+    this->_offsets = std::move(rhs._offsets);
+    this->_positions = std::move(rhs._positions);
+    std::swap(this->_spill_fd, rhs._spill_fd);
+    this->_spill_size = rhs._spill_size;
+    std::swap(this->_map, rhs._map);
+    std::swap(this->_map_size, rhs._map_size);
+    this->_sorted = rhs._sorted;
+    return *this;
+}
+
+void dts::line_array::close() {
+    if (this->_map) { ::munmap(const_cast<char*>(this->_map), this->_map_size); }
+    if (this->_spill_fd != -1) { ::close(this->_spill_fd); }
+    this->_map = nullptr;
+    this->_map_size = 0;
+    this->_spill_fd = -1;
+}
+
+void dts::line_array::clear() {
+    close();
+    this->_lines.clear();
+    this->_info.clear();
+    this->_rendered.clear();
+    this->_num_spilled = 0;
+    this->_num_appended = 0;
+    this->_memory = 0;
+    this->_offsets.clear();
+    this->_positions.clear();
+    this->_spill_size = 0;
+    this->_sorted = true;
+}
+
+void dts::line_array::merge(std::vector<line_array>& batches) {
+    const auto num_batches = batches.size();
+    std::vector<size_type> positions(num_batches);
+    while (true) {
+        auto min = num_batches;
+        for (size_t k=0; k<num_batches; ++k) {
+            const auto& batch = batches[k];
+            const auto i = positions[k];
+            if (i == batch._lines.size()) { continue; }
+            if (min == num_batches ||
+                batch._info[i].timestamp < batches[min]._info[positions[min]].timestamp) {
+                min = k;
+            }
+        }
+        if (min == num_batches) { break; }
+        auto& batch = batches[min];
+        auto& i = positions[min];
+        emplace_back(std::move(batch._lines[i]), batch._info[i]);
+        ++i;
+    }
+    for (auto& batch : batches) { batch.clear(); }
+}
+
+void dts::line_array::filter(const std::string& regex_string) {
+    if (regex_string.empty()) { this->_filter.reset(); }
+    else { this->_filter.reset(new line_regex(regex_string)); }
+}
+
+void dts::line_array::prefix(line_info::stream_type stream, std::string rhs) {
+    if (stream >= this->_prefixes.size()) { this->_prefixes.resize(stream+1); }
+    this->_prefixes[stream] = std::move(rhs);
+}
+
+auto dts::line_array::prefix(line_info::stream_type stream) const noexcept -> const std::string& {
+    static const std::string empty;
+    return stream < this->_prefixes.size() ? this->_prefixes[stream] : empty;
+}
+
+auto dts::line_array::strings() const -> const string_array& {
+    std::lock_guard<std::mutex> lock(this->_rendered_mutex);
+    const auto n = this->_lines.size();
+    this->_rendered.reserve(n);
+    for (auto i=this->_rendered.size(); i<n; ++i) {
+        const auto& p = prefix(this->_info[i].stream);
+        const auto& text = this->_lines[i];
+        std::string s;
+        s.reserve(p.size() + text.size());
+        s.append(p);
+        s.append(text);
+        this->_rendered.emplace_back(std::move(s));
+    }
+    return this->_rendered;
+}
+
+dts::line_array::operator const string_array&() const {
+    if (this->_num_spilled != 0) {
+        throw std::runtime_error("some lines were moved to the temporary file, "
+                                 "use dts::line_array instead of string array");
+    }
+    return strings();
+}
+
+void dts::line_array::shrink() {
+    if (this->_max_memory == 0 || this->_memory <= this->_max_memory) { return; }
+    const size_t target = this->_max_memory/4*3;
+    const size_type nlines = this->_lines.size();
+    const size_type first_position = first_in_memory();
+    size_type nevicted = 0, nretained = 0;
+    std::string buffer;
+    for (; nevicted<nlines && this->_memory>target; ++nevicted) {
+        auto& line = this->_lines[nevicted];
+        const auto& info = this->_info[nevicted];
+        this->_memory -= sizeof(std::string) + sizeof(line_info) + line.capacity();
+        if (this->_filter) {
+            const auto& p = prefix(info.stream);
+            dts::line tmp;
+            tmp.data = line.data();
+            tmp.size = line.size();
+            tmp.prefix = p.data();
+            tmp.prefix_size = p.size();
+            if (!this->_filter->search(tmp)) {
+                // positions of the spilled lines are no longer equal to their indices
+                if (this->_positions.empty()) {
+                    this->_positions.resize(this->_num_spilled + nretained);
+                    std::iota(this->_positions.begin(), this->_positions.end(), size_type(0));
+                }
+                continue;
+            }
+        }
+        if (!this->_positions.empty()) {
+            this->_positions.emplace_back(first_position + nevicted);
+        }
+        using namespace std::chrono;
+        spilled_line_header header{};
+        header.timestamp = duration_cast<nanoseconds>(info.timestamp.time_since_epoch()).count();
+        header.sequence = info.sequence;
+        header.stream = info.stream;
+        header.size = line.size();
+        this->_offsets.emplace_back(this->_spill_size + buffer.size());
+        buffer.append(reinterpret_cast<const char*>(&header), sizeof(header));
+        buffer.append(line);
+        buffer.append(record_size(line.size()) - sizeof(header) - line.size(), '\0');
+        ++nretained;
+    }
+    if (nretained != 0) {
+        if (this->_spill_fd == -1) { this->_spill_fd = make_temporary_file(); }
+        write_all(this->_spill_fd, buffer.data(), buffer.size());
+        this->_spill_size += buffer.size();
+        this->_num_spilled += nretained;
+    }
+    this->_lines.erase(this->_lines.begin(), this->_lines.begin()+nevicted);
+    this->_info.erase(this->_info.begin(), this->_info.begin()+nevicted);
+    {
+        std::lock_guard<std::mutex> lock(this->_rendered_mutex);
+        auto& r = this->_rendered;
+        r.erase(r.begin(), r.begin()+std::min(nevicted, r.size()));
+    }
+}
+
+void dts::line_array::map_spill_file() const {
+    if (this->_map_size == this->_spill_size) { return; }
+    if (this->_map) { ::munmap(const_cast<char*>(this->_map), this->_map_size); }
+    this->_map = nullptr;
+    this->_map_size = 0;
+    void* ptr = ::mmap(nullptr, this->_spill_size, PROT_READ, MAP_SHARED, this->_spill_fd, 0);
+    if (ptr == MAP_FAILED) { throw std::system_error(errno, std::generic_category()); }
+    this->_map = static_cast<const char*>(ptr);
+    this->_map_size = this->_spill_size;
+}
+
+size_t dts::line_array::read_spilled_line(size_t offset, line& result) const {
+    using namespace std::chrono;
+    spilled_line_header header;
+    std::memcpy(&header, this->_map+offset, sizeof(header));
+    result.data = this->_map + offset + sizeof(header);
+    result.size = header.size;
+    result.info.timestamp = time_point(duration_cast<time_point::duration>(
+        nanoseconds(header.timestamp)));
+    result.info.stream = header.stream;
+    result.info.sequence = header.sequence;
+    const auto& p = prefix(header.stream);
+    result.prefix = p.data();
+    result.prefix_size = p.size();
+    return offset + record_size(header.size);
+}
+
+auto dts::line_array::operator[](size_type i) const -> line {
+    line result;
+    if (i >= this->_num_spilled) {
+        const auto& s = this->_lines[i-this->_num_spilled];
+        result.data = s.data();
+        result.size = s.size();
+        result.info = this->_info[i-this->_num_spilled];
+        const auto& p = prefix(result.info.stream);
+        result.prefix = p.data();
+        result.prefix_size = p.size();
+        return result;
+    }
+    map_spill_file();
+    read_spilled_line(spilled_line_offset(i), result);
+    return result;
+}
+
+auto dts::line_array::index(size_type p) const noexcept -> size_type {
+    const auto first = first_in_memory();
+    if (p >= first) { return std::min(this->_num_spilled + (p - first), size()); }
+    if (this->_positions.empty()) { return p; }
+    const auto& v = this->_positions;
+    return std::lower_bound(v.begin(), v.end(), p) - v.begin();
+}
+
+auto dts::line_array::ordered() const -> index_array {
+    std::vector<time_point> timestamps;
+    timestamps.reserve(size());
+    for (const auto& line : *this) { timestamps.emplace_back(line.info.timestamp); }
+    index_array result(size());
+    std::iota(result.begin(), result.end(), size_type(0));
+    std::stable_sort(result.begin(), result.end(), [&timestamps] (size_type a, size_type b) {
+        return timestamps[a] < timestamps[b];
+    });
+    return result;
+}
+
+dts::line_array::const_iterator::const_iterator(const line_array* lines, size_type index):
+_lines(lines), _index(index) {
+    if (this->_index < this->_lines->_num_spilled) {
+        this->_lines->map_spill_file();
+        this->_offset = this->_lines->spilled_line_offset(this->_index);
+    }
+    load();
+}
+
+void dts::line_array::const_iterator::load() {
+    const auto& lines = *this->_lines;
+    if (this->_index >= lines.size()) { return; }
+    if (this->_index >= lines._num_spilled) {
+        this->_line = lines[this->_index];
+    } else {
+        lines.read_spilled_line(this->_offset, this->_line);
+    }
+}
+
+auto dts::line_array::const_iterator::operator++() -> const_iterator& {
+    // spilled lines are written one after another, hence the offset of the next
+    // spilled line is always the end of the current one
+    if (this->_index < this->_lines->_num_spilled) {
+        this->_offset += record_size(this->_line.size);
+    }
+    ++this->_index;
+    load();
+    return *this;
+}
@@ -0,0 +1,298 @@
+#ifndef DTEST_LINE_ARRAY_HH
+#define DTEST_LINE_ARRAY_HH
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <regex>
+#include <string>
+#include <vector>
+
+namespace dts {
+
+    using string_array = std::vector<std::string>;
+
+    /// Information about when and where the line was captured.
+    struct line_info {
+        /// Steady clock uses CLOCK_MONOTONIC on Linux.
+        using clock_type = std::chrono::steady_clock;
+        using time_point = clock_type::time_point;
+        using stream_type = std::uint32_t;
+        using sequence_type = std::uint64_t;
+        /// The time when the line was read from the pipe.
+        time_point timestamp;
+        /// The index of the stream (stdout/stderr of a particular process).
+        stream_type stream = 0;
+        /// Line number within the stream starting from nought.
+        sequence_type sequence = 0;
+    };
+
+    /**
+    \brief Captured line that does not own its text.
+    \details The text does not include the prefix (node name followed by colon
+    and space), the prefix is shared by all lines of the same stream.
+    */
+    struct line {
+        const char* data = nullptr;
+        size_t size = 0;
+        line_info info;
+        const char* prefix = nullptr;
+        size_t prefix_size = 0;
+        inline const char* begin() const noexcept { return this->data; }
+        inline const char* end() const noexcept { return this->data + this->size; }
+        inline std::string text() const { return std::string(this->data, this->size); }
+
+        /// \return the line with the prefix
+        inline std::string str() const {
+            std::string s;
+            s.reserve(this->prefix_size + this->size);
+            s.append(this->prefix, this->prefix_size);
+            s.append(this->data, this->size);
+            return s;
+        }
+    };
+
+    /**
+    \brief Regular expression that matches the lines as if they were stored
+    with their prefixes.
+    \details The expressions that start with the prefix (e.g. "^x1: ")
+    compare the prefix of the line and match the rest of the expression
+    against the text. Other expressions are matched against the line that is
+    rendered with its prefix in the buffer that is reused between the calls,
+    hence the same object can not be used from several threads at the same time.
+    */
+    class line_regex {
+
+    private:
+        std::regex _expression;
+        std::string _prefix;
+        std::regex _rest;
+        mutable std::string _buffer;
+
+    public:
+        explicit line_regex(const std::string& regex_string);
+
+        /// \return true if the expression matches the whole line
+        bool match(const line& l) const;
+        bool match(const line& l, std::cmatch& result) const;
+        /// \return true if the expression matches a part of the line
+        bool search(const line& l) const;
+        bool search(const line& l, std::cmatch& result) const;
+
+        /// The number of capture groups.
+        inline unsigned mark_count() const { return this->_expression.mark_count(); }
+
+    private:
+        template <class Function> bool apply(const line& l, Function f) const;
+
+    };
+
+    /**
+    \brief Lines captured from all processes in the order they were read
+    together with their timestamps.
+    \details By default all lines are kept in memory. When maximum memory
+    size is set, the oldest lines are moved to memory-mapped temporary
+    file in segments, and only the lines that match the filter (if any) are retained.
+    Line indices span both spilled and in-memory lines. The indices of the newer
+    lines decrease when the filter discards older lines, hence the references that
+    outlive \link shrink \endlink store line positions (the number of lines
+    appended before the line) that never change.
+    */
+    class line_array {
+
+    public:
+        using size_type = string_array::size_type;
+        using index_array = std::vector<size_type>;
+        using time_point = line_info::time_point;
+
+        class const_iterator {
+
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = line;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const line*;
+            using reference = const line&;
+
+        private:
+            const line_array* _lines = nullptr;
+            size_type _index = 0;
+            size_t _offset = 0;
+            line _line;
+
+        public:
+            const_iterator() = default;
+            const_iterator(const line_array* lines, size_type index);
+            inline reference operator*() const noexcept { return this->_line; }
+            inline pointer operator->() const noexcept { return &this->_line; }
+            const_iterator& operator++();
+            inline const_iterator operator++(int) { auto tmp = *this; ++*this; return tmp; }
+            inline size_type index() const noexcept { return this->_index; }
+
+            inline bool operator==(const const_iterator& rhs) const noexcept {
+                return this->_index == rhs._index;
+            }
+
+            inline bool operator!=(const const_iterator& rhs) const noexcept {
+                return !operator==(rhs);
+            }
+
+        private:
+            void load();
+
+        };
+
+    private:
+        string_array _lines;
+        std::vector<line_info> _info;
+        /// Prefixes of the streams (deque does not move the elements).
+        std::deque<std::string> _prefixes;
+        /// In-memory lines with prefixes rendered on demand.
+        mutable string_array _rendered;
+        mutable std::mutex _rendered_mutex;
+        size_type _num_spilled = 0;
+        size_type _num_appended = 0;
+        size_t _memory = 0;
+        size_t _max_memory = 0;
+        std::unique_ptr<line_regex> _filter;
+        /// Offsets of spilled lines in the temporary file.
+        std::vector<size_t> _offsets;
+        /// Positions of spilled lines (empty until the filter discards the first line).
+        std::vector<size_type> _positions;
+        int _spill_fd = -1;
+        size_t _spill_size = 0;
+        mutable const char* _map = nullptr;
+        mutable size_t _map_size = 0;
+        bool _sorted = true;
+
+    public:
+
+        line_array() = default;
+        ~line_array();
+        line_array(const line_array&) = delete;
+        line_array& operator=(const line_array&) = delete;
+        line_array(line_array&& rhs) noexcept;
+        line_array& operator=(line_array&& rhs) noexcept;
+
+        /// Append the line without the prefix.
+        inline void
+        emplace_back(std::string&& line, const line_info& info) {
+            this->_memory += sizeof(std::string) + sizeof(line_info) + line.capacity();
+            if (this->_sorted && !this->_info.empty() &&
+                info.timestamp < this->_info.back().timestamp) {
+                this->_sorted = false;
+            }
+            this->_lines.emplace_back(std::move(line));
+            this->_info.emplace_back(info);
+            ++this->_num_appended;
+        }
+
+        line operator[](size_type i) const;
+        inline line_info info(size_type i) const { return (*this)[i].info; }
+        inline time_point timestamp(size_type i) const { return (*this)[i].info.timestamp; }
+        inline size_type size() const noexcept { return this->_num_spilled + this->_lines.size(); }
+        inline bool empty() const noexcept { return size() == 0; }
+        inline const_iterator begin() const { return const_iterator(this, 0); }
+        inline const_iterator end() const noexcept { return const_iterator(this, size()); }
+        inline void reserve(size_type n) { this->_lines.reserve(n); this->_info.reserve(n); }
+
+        /// The number of lines that were ever appended to the array including
+        /// the lines that were discarded by the filter.
+        inline size_type appended() const noexcept { return this->_num_appended; }
+        /// The number of lines that were moved to the temporary file.
+        inline size_type spilled() const noexcept { return this->_num_spilled; }
+
+        /// \return the position of the line with index \p i
+        /// (the position of the next line if \p i equals the size of the array)
+        inline size_type position(size_type i) const noexcept {
+            if (i >= this->_num_spilled) { return i - this->_num_spilled + first_in_memory(); }
+            return this->_positions.empty() ? i : this->_positions[i];
+        }
+
+        /// \return the index of the first line with position greater than or equal to \p p
+        size_type index(size_type p) const noexcept;
+        /// The amount of memory occupied by in-memory lines.
+        inline size_t memory() const noexcept { return this->_memory; }
+        inline size_t max_memory() const noexcept { return this->_max_memory; }
+        /// Set maximum amount of memory for in-memory lines (zero means unlimited).
+        inline void max_memory(size_t rhs) noexcept { this->_max_memory = rhs; }
+        /**
+        \brief Move in-memory lines of \p batches to the end of the array
+        in timestamp order and clear the batches.
+        \details Lines of each batch are expected to be in timestamp order.
+        */
+        void merge(std::vector<line_array>& batches);
+
+        /// Remove all lines including the spilled ones.
+        void clear();
+
+        /// Spill only the lines that match \p regex_string, discard the others.
+        void filter(const std::string& regex_string);
+
+        /**
+        \brief Move the oldest lines to the temporary file if memory limit is exceeded.
+        \details Reduces the memory to 3/4 of the limit to amortise the cost.
+        */
+        void shrink();
+
+        /**
+        \brief In-memory lines with prefixes, but without capture information.
+        \details The lines are rendered with their prefixes on the first call,
+        and only the new lines are rendered on subsequent calls.
+        */
+        const string_array& strings() const;
+
+        /**
+        \brief Tests that take string array as an argument work without modifications.
+        \throw std::runtime_error if some lines were moved to the temporary file,
+        since the array contains only in-memory lines
+        */
+        operator const string_array&() const;
+
+        /// Set the prefix (node name followed by colon and space) of the lines of \p stream.
+        void prefix(line_info::stream_type stream, std::string rhs);
+
+        /// \return the prefix of the lines of \p stream
+        const std::string& prefix(line_info::stream_type stream) const noexcept;
+
+        /**
+        \brief Merged view of all streams.
+        \return line indices ordered by timestamp; lines with equal timestamps
+        retain the order in which they were read
+        */
+        index_array ordered() const;
+
+        /// Map spilled lines into memory before reading the array from several threads.
+        inline void map() const { if (this->_spill_fd != -1) { map_spill_file(); } }
+
+        /// Whether lines were appended in timestamp order.
+        inline bool sorted() const noexcept { return this->_sorted; }
+
+        /// Call \p func for every line in timestamp order.
+        template <class Function> inline void
+        for_each_ordered(Function func) const {
+            if (this->_sorted) {
+                for (const auto& line : *this) { func(line); }
+            } else {
+                for (auto i : ordered()) { func((*this)[i]); }
+            }
+        }
+
+    private:
+        void map_spill_file() const;
+        inline size_t spilled_line_offset(size_type i) const { return this->_offsets[i]; }
+        /// The position of the oldest in-memory line.
+        inline size_type first_in_memory() const noexcept {
+            return this->_num_appended - this->_lines.size();
+        }
+        size_t read_spilled_line(size_t offset, line& result) const;
+        void close();
+
+    };
+
+}
+
+#endif // vim:filetype=cpp
@@ -0,0 +1,64 @@
+#include <algorithm>
+#include <ostream>
+
+#include <dtest/metrics.hh>
+
+namespace {
+
+    inline unsigned bucket_index(dts::histogram::value_type value) {
+        unsigned i = 0;
+        while (value >>= 1) { ++i; }
+        return i;
+    }
+
+}
+
+void dts::histogram::add(value_type value) {
+    ++this->_buckets[bucket_index(value)];
+    ++this->_count;
+    this->_sum += value;
+    if (value < this->_min) { this->_min = value; }
+    if (value > this->_max) { this->_max = value; }
+}
+
+auto dts::histogram::quantile(double q) const -> value_type {
+    if (this->_count == 0) { return 0; }
+    const value_type rank = value_type(q*(this->_count-1)) + 1;
+    value_type n = 0;
+    const auto nbuckets = this->_buckets.size();
+    for (size_t i=0; i<nbuckets; ++i) {
+        n += this->_buckets[i];
+        if (n >= rank) {
+            const value_type upper = i+1 == nbuckets
+                ? this->_max : (value_type(2) << i) - 1;
+            return std::min(std::max(upper, this->min()), this->_max);
+        }
+    }
+    return this->_max;
+}
+
+std::ostream& dts::operator<<(std::ostream& out, const histogram& rhs) {
+    return out << "count " << rhs.count()
+        << " sum " << rhs.sum()
+        << " min " << rhs.min()
+        << " p50 " << rhs.quantile(0.50)
+        << " p99 " << rhs.quantile(0.99)
+        << " max " << rhs.max();
+}
+
+std::ostream& dts::operator<<(std::ostream& out, const stream_metrics& rhs) {
+    return out << "lines " << rhs.lines << " bytes " << rhs.bytes << " stalls " << rhs.stalls
+        << " truncated " << rhs.truncated;
+}
+
+std::ostream& dts::operator<<(std::ostream& out, const metrics& rhs) {
+    out << "wakeups " << rhs._wakeups << '\n';
+    out << "copy_ns " << rhs._copy << '\n';
+    out << "run_tests_ns " << rhs._run_tests << '\n';
+    out << "line_memory " << rhs._line_memory << '\n';
+    out << "peak_line_memory " << rhs._peak_line_memory << '\n';
+    for (const auto& pair : rhs._tests) {
+        out << "test_ns \"" << pair.first << "\" " << pair.second << '\n';
+    }
+    return out;
+}
@@ -0,0 +1,113 @@
+#ifndef DTEST_METRICS_HH
+#define DTEST_METRICS_HH
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace dts {
+
+    /// Histogram with power-of-two buckets. Stores durations in nanoseconds
+    /// and other values (e.g. byte counts) as is.
+    class histogram {
+
+    public:
+        using value_type = std::uint64_t;
+
+    private:
+        std::array<value_type,64> _buckets{};
+        value_type _count = 0;
+        value_type _sum = 0;
+        value_type _min = std::numeric_limits<value_type>::max();
+        value_type _max = 0;
+
+    public:
+        void add(value_type value);
+
+        template <class Rep, class Period> inline void
+        add(std::chrono::duration<Rep,Period> d) {
+            using namespace std::chrono;
+            add(value_type(duration_cast<nanoseconds>(d).count()));
+        }
+
+        /// \return upper bound of the bucket that contains the quantile \p q
+        value_type quantile(double q) const;
+
+        inline value_type count() const noexcept { return this->_count; }
+        inline value_type sum() const noexcept { return this->_sum; }
+        inline value_type min() const noexcept { return this->_count == 0 ? 0 : this->_min; }
+        inline value_type max() const noexcept { return this->_max; }
+        inline bool empty() const noexcept { return this->_count == 0; }
+
+    };
+
+    std::ostream& operator<<(std::ostream& out, const histogram& rhs);
+
+    struct stream_metrics {
+        using value_type = std::uint64_t;
+        /// The number of lines read from the stream.
+        value_type lines = 0;
+        /// The number of bytes read from the stream.
+        value_type bytes = 0;
+        /// How many times the pipe was full when dtest read from it
+        /// (the child process was blocked on write).
+        value_type stalls = 0;
+        /// The number of lines that were longer than the maximum line length.
+        value_type truncated = 0;
+    };
+
+    std::ostream& operator<<(std::ostream& out, const stream_metrics& rhs);
+
+    /// Counters and histograms that measure dtest itself.
+    class metrics {
+
+    public:
+        using value_type = std::uint64_t;
+        using clock_type = std::chrono::steady_clock;
+        using test_array = std::vector<std::pair<std::string,histogram>>;
+
+    private:
+        value_type _wakeups = 0;
+        histogram _copy;
+        histogram _run_tests;
+        test_array _tests;
+        value_type _line_memory = 0;
+        value_type _peak_line_memory = 0;
+
+    public:
+        inline void wakeup() noexcept { ++this->_wakeups; }
+        inline void copy(clock_type::duration d) { this->_copy.add(d); }
+        inline void run_tests(clock_type::duration d) { this->_run_tests.add(d); }
+
+        inline void
+        test(const std::string& description, const histogram& durations) {
+            this->_tests.emplace_back(description, durations);
+        }
+
+        inline void
+        line_memory(value_type nbytes) noexcept {
+            this->_line_memory = nbytes;
+            if (nbytes > this->_peak_line_memory) { this->_peak_line_memory = nbytes; }
+        }
+
+        inline value_type wakeups() const noexcept { return this->_wakeups; }
+        inline const histogram& copy() const noexcept { return this->_copy; }
+        inline const histogram& run_tests() const noexcept { return this->_run_tests; }
+        inline const test_array& tests() const noexcept { return this->_tests; }
+        inline value_type line_memory() const noexcept { return this->_line_memory; }
+        inline value_type peak_line_memory() const noexcept { return this->_peak_line_memory; }
+
+        friend std::ostream& operator<<(std::ostream& out, const metrics& rhs);
+
+    };
+
+    std::ostream& operator<<(std::ostream& out, const metrics& rhs);
+
+}
+
+#endif // vim:filetype=cpp
@@ -0,0 +1,254 @@
+#include <arpa/inet.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <net/if.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+
+#include <dtest/packet_capture.hh>
+
+namespace {
+
+    inline int check(int ret) {
+        if (ret == -1) { throw std::system_error(errno, std::generic_category()); }
+        return ret;
+    }
+
+    template <class T>
+    inline void set_option(int fd, int name, const T& value) {
+        check(::setsockopt(fd, SOL_PACKET, name, &value, sizeof(value)));
+    }
+
+    inline std::uint32_t padding(std::uint32_t size) { return (4 - size%4) % 4; }
+
+    constexpr const std::uint32_t frame_size = 2048;
+    /// Retire partially filled block after this number of milliseconds.
+    constexpr const std::uint32_t block_timeout = 10;
+
+    // pcapng block types and options
+    constexpr const std::uint32_t section_header_block = 0x0A0D0D0A;
+    constexpr const std::uint32_t interface_description_block = 1;
+    constexpr const std::uint32_t enhanced_packet_block = 6;
+    constexpr const std::uint32_t byte_order_magic = 0x1A2B3C4D;
+    constexpr const std::uint16_t opt_endofopt = 0;
+    constexpr const std::uint16_t opt_comment = 1;
+    constexpr const std::uint16_t if_name = 2;
+    constexpr const std::uint16_t if_tsresol = 9;
+    constexpr const std::uint16_t linktype_ethernet = 1;
+
+    /// Offsets in Ethernet frame.
+    constexpr const size_t ethertype_offset = 12;
+    constexpr const size_t ipv4_source_offset = ETH_HLEN + 12;
+    constexpr const size_t ipv4_destination_offset = ETH_HLEN + 16;
+
+}
+
+constexpr const size_t dts::packet_capture::unknown_node;
+
+std::ostream& dts::operator<<(std::ostream& out, const traffic_summary& rhs) {
+    return out << "sent " << rhs.packets_sent << " packets " << rhs.bytes_sent << " bytes"
+        << " received " << rhs.packets_received << " packets "
+        << rhs.bytes_received << " bytes";
+}
+
+dts::packet_capture::packet_capture(int interface_index,
+                                    const std::vector<cluster_node>& nodes,
+                                    const std::string& filename,
+                                    size_t block_size, size_t num_blocks):
+_socket(check(::socket(AF_PACKET, SOCK_RAW | SOCK_CLOEXEC | SOCK_NONBLOCK, htons(ETH_P_ALL)))),
+_block_size(block_size), _num_blocks(num_blocks),
+_summaries(nodes.size()) {
+    const auto num_nodes = nodes.size();
+    for (size_t i=0; i<num_nodes; ++i) {
+        const auto& node = nodes[i];
+        std::stringstream tmp;
+        tmp << node.peer_interface_address().address();
+        ::in_addr address{};
+        if (::inet_pton(AF_INET, tmp.str().data(), &address) != 1) {
+            throw std::invalid_argument("bad node address: " + tmp.str());
+        }
+        this->_nodes.emplace(address.s_addr, i);
+        this->_names.emplace_back(node.name());
+    }
+    const int fd = this->_socket.fd();
+    set_option(fd, PACKET_VERSION, int(TPACKET_V3));
+    ::tpacket_req3 req{};
+    req.tp_block_size = block_size;
+    req.tp_block_nr = num_blocks;
+    req.tp_frame_size = frame_size;
+    req.tp_frame_nr = block_size/frame_size*num_blocks;
+    req.tp_retire_blk_tov = block_timeout;
+    set_option(fd, PACKET_RX_RING, req);
+    void* ptr = ::mmap(nullptr, block_size*num_blocks, PROT_READ | PROT_WRITE,
+                       MAP_SHARED, fd, 0);
+    if (ptr == MAP_FAILED) { throw std::system_error(errno, std::generic_category()); }
+    this->_ring = std::unique_ptr<char,ring_deleter>(
+        static_cast<char*>(ptr), ring_deleter{block_size*num_blocks});
+    ::sockaddr_ll address{};
+    address.sll_family = AF_PACKET;
+    address.sll_protocol = htons(ETH_P_ALL);
+    address.sll_ifindex = interface_index;
+    check(::bind(fd, reinterpret_cast<::sockaddr*>(&address), sizeof(address)));
+    // the bridge passes forwarded frames up the stack only in promiscuous mode
+    ::packet_mreq membership{};
+    membership.mr_ifindex = interface_index;
+    membership.mr_type = PACKET_MR_PROMISC;
+    set_option(fd, PACKET_ADD_MEMBERSHIP, membership);
+    if (!filename.empty()) {
+        this->_file.reset(std::fopen(filename.data(), "wb"));
+        if (!this->_file) { throw std::system_error(errno, std::generic_category()); }
+        write_header(interface_index);
+    }
+}
+
+void dts::packet_capture::ring_deleter::operator()(char* ptr) const noexcept {
+    ::munmap(ptr, this->size);
+}
+
+void dts::packet_capture::read() {
+    if (!this->_ring) { return; }
+    for (size_t n=0; n<this->_num_blocks; ++n) {
+        auto block = reinterpret_cast<::tpacket_block_desc*>(
+            this->_ring.get() + this->_block*this->_block_size);
+        auto& header = block->hdr.bh1;
+        const volatile auto& status = header.block_status;
+        if ((status & TP_STATUS_USER) == 0) { break; }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        auto ptr = reinterpret_cast<const char*>(block) + header.offset_to_first_pkt;
+        const auto num_packets = header.num_pkts;
+        for (std::uint32_t i=0; i<num_packets; ++i) {
+            auto packet = reinterpret_cast<const ::tpacket3_hdr*>(ptr);
+            frame(ptr + packet->tp_mac, packet->tp_snaplen, packet->tp_len,
+                  std::uint64_t(packet->tp_sec)*1000000000UL + packet->tp_nsec);
+            ptr += packet->tp_next_offset;
+        }
+        // return the block to the kernel
+        std::atomic_thread_fence(std::memory_order_release);
+        header.block_status = TP_STATUS_KERNEL;
+        this->_block = (this->_block + 1) % this->_num_blocks;
+    }
+}
+
+void dts::packet_capture::close() {
+    if (!this->_ring) { return; }
+    read();
+    ::tpacket_stats_v3 stats{};
+    ::socklen_t size = sizeof(stats);
+    if (::getsockopt(this->_socket.fd(), SOL_PACKET, PACKET_STATISTICS, &stats, &size) == 0) {
+        this->_dropped += stats.tp_drops;
+    }
+    this->_file.reset();
+    this->_ring.reset();
+    this->_socket.close();
+}
+
+void dts::packet_capture::frame(const char* data, std::uint32_t size, std::uint32_t length,
+                                std::uint64_t nanoseconds) {
+    auto source = unknown_node, destination = unknown_node;
+    if (size >= ipv4_destination_offset + 4 &&
+        std::uint8_t(data[ethertype_offset]) == (ETH_P_IP >> 8) &&
+        std::uint8_t(data[ethertype_offset+1]) == (ETH_P_IP & 0xff)) {
+        std::uint32_t address = 0;
+        std::memcpy(&address, data + ipv4_source_offset, sizeof(address));
+        auto result = this->_nodes.find(address);
+        if (result != this->_nodes.end()) { source = result->second; }
+        std::memcpy(&address, data + ipv4_destination_offset, sizeof(address));
+        result = this->_nodes.find(address);
+        if (result != this->_nodes.end()) { destination = result->second; }
+    }
+    if (source != unknown_node) {
+        auto& s = this->_summaries[source];
+        ++s.packets_sent;
+        s.bytes_sent += length;
+    }
+    if (destination != unknown_node) {
+        auto& s = this->_summaries[destination];
+        ++s.packets_received;
+        s.bytes_received += length;
+    }
+    if (!this->_file) { return; }
+    this->_comment.clear();
+    if (source != unknown_node || destination != unknown_node) {
+        this->_comment += source == unknown_node ? "?" : this->_names[source];
+        this->_comment += " -> ";
+        this->_comment += destination == unknown_node ? "?" : this->_names[destination];
+    }
+    const std::uint32_t comment_size = this->_comment.size();
+    const std::uint32_t options_size = comment_size == 0 ? 0 :
+        sizeof(std::uint16_t)*2 + comment_size + padding(comment_size) + sizeof(std::uint16_t)*2;
+    const std::uint32_t block_size = sizeof(std::uint32_t)*7 + size + padding(size) +
+        options_size + sizeof(std::uint32_t);
+    const std::uint32_t header[7] = {
+        enhanced_packet_block, block_size, 0,
+        std::uint32_t(nanoseconds >> 32), std::uint32_t(nanoseconds), size, length};
+    constexpr const char zeroes[4] = {};
+    write(header, sizeof(header));
+    write(data, size);
+    write(zeroes, padding(size));
+    if (comment_size != 0) {
+        const std::uint16_t option[2] = {opt_comment, std::uint16_t(comment_size)};
+        write(option, sizeof(option));
+        write(this->_comment.data(), comment_size);
+        write(zeroes, padding(comment_size));
+        const std::uint16_t end[2] = {opt_endofopt, 0};
+        write(end, sizeof(end));
+    }
+    write(&block_size, sizeof(block_size));
+}
+
+void dts::packet_capture::write_header(int interface_index) {
+    const std::uint32_t section[3] = {section_header_block, 28, byte_order_magic};
+    const std::uint16_t version[2] = {1, 0};
+    // unknown section length
+    const std::int64_t section_length = -1;
+    const std::uint32_t section_size = 28;
+    write(section, sizeof(section));
+    write(version, sizeof(version));
+    write(&section_length, sizeof(section_length));
+    write(&section_size, sizeof(section_size));
+    char name[IF_NAMESIZE] = {};
+    ::if_indextoname(interface_index, name);
+    const std::uint32_t name_size = std::strlen(name);
+    const std::uint32_t options_size =
+        sizeof(std::uint16_t)*2 + name_size + padding(name_size) + // if_name
+        sizeof(std::uint16_t)*2 + sizeof(std::uint32_t) + // if_tsresol
+        sizeof(std::uint16_t)*2; // opt_endofopt
+    const std::uint32_t block_size = sizeof(std::uint32_t)*4 + options_size +
+        sizeof(std::uint32_t);
+    const std::uint32_t header[2] = {interface_description_block, block_size};
+    const std::uint16_t link_type[2] = {linktype_ethernet, 0};
+    // no limit on the captured frame size
+    const std::uint32_t snapshot_length = 0;
+    constexpr const char zeroes[4] = {};
+    write(header, sizeof(header));
+    write(link_type, sizeof(link_type));
+    write(&snapshot_length, sizeof(snapshot_length));
+    const std::uint16_t name_option[2] = {if_name, std::uint16_t(name_size)};
+    write(name_option, sizeof(name_option));
+    write(name, name_size);
+    write(zeroes, padding(name_size));
+    // nanosecond timestamps
+    const std::uint16_t resolution_option[2] = {if_tsresol, 1};
+    const char resolution[4] = {9, 0, 0, 0};
+    write(resolution_option, sizeof(resolution_option));
+    write(resolution, sizeof(resolution));
+    const std::uint16_t end[2] = {opt_endofopt, 0};
+    write(end, sizeof(end));
+    write(&block_size, sizeof(block_size));
+}
+
+void dts::packet_capture::write(const void* data, size_t size) {
+    if (size == 0) { return; }
+    if (std::fwrite(data, 1, size, this->_file.get()) != size) {
+        throw std::system_error(errno, std::generic_category());
+    }
+}
@@ -0,0 +1,115 @@
+#ifndef DTEST_PACKET_CAPTURE_HH
+#define DTEST_PACKET_CAPTURE_HH
+
+#include <cstdint>
+#include <cstdio>
+#include <iosfwd>
+#include <limits>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <unistdx/io/fildes>
+
+#include <dtest/cluster_node.hh>
+
+namespace dts {
+
+    /// The number of frames and bytes that the node sent and received via the bridge.
+    struct traffic_summary {
+        std::uint64_t packets_sent = 0;
+        std::uint64_t bytes_sent = 0;
+        std::uint64_t packets_received = 0;
+        std::uint64_t bytes_received = 0;
+    };
+
+    std::ostream& operator<<(std::ostream& out, const traffic_summary& rhs);
+
+    /**
+    \brief Captures the frames that pass through the cluster bridge.
+    \details The frames are read from AF_PACKET socket via TPACKET_V3
+    memory-mapped ring: the kernel fills whole blocks of frames and dtest
+    reads them in place when the block is full or its timeout expires.
+    The frames are attributed to the nodes by IPv4 source and destination
+    addresses, and are optionally written to pcapng file with node names
+    in packet comments.
+    */
+    class packet_capture {
+
+    public:
+        static constexpr const size_t unknown_node = std::numeric_limits<size_t>::max();
+
+    private:
+        /// Unmaps the ring, so that it is released if the constructor throws.
+        struct ring_deleter {
+            size_t size;
+            void operator()(char* ptr) const noexcept;
+        };
+        struct file_deleter {
+            inline void operator()(std::FILE* file) const noexcept { std::fclose(file); }
+        };
+
+    private:
+        sys::fildes _socket;
+        std::unique_ptr<char,ring_deleter> _ring;
+        size_t _block_size = 0;
+        size_t _num_blocks = 0;
+        size_t _block = 0;
+        /// Node index by IPv4 address in network byte order.
+        std::unordered_map<std::uint32_t,size_t> _nodes;
+        std::vector<std::string> _names;
+        std::vector<traffic_summary> _summaries;
+        std::uint64_t _dropped = 0;
+        std::unique_ptr<std::FILE,file_deleter> _file;
+        /// Reused buffer for packet comments.
+        std::string _comment;
+
+    public:
+
+        packet_capture() = default;
+
+        /**
+        \param interface_index the bridge interface
+        \param filename pcapng file (empty string disables the file)
+        \param block_size the size of the ring block in bytes
+        (the multiple of the page size)
+        \param num_blocks the number of blocks in the ring
+        */
+        packet_capture(int interface_index, const std::vector<cluster_node>& nodes,
+                       const std::string& filename,
+                       size_t block_size=1024*1024, size_t num_blocks=16);
+        ~packet_capture() = default;
+        packet_capture(const packet_capture&) = delete;
+        packet_capture& operator=(const packet_capture&) = delete;
+        packet_capture(packet_capture&& rhs) = default;
+        packet_capture& operator=(packet_capture&& rhs) = default;
+
+        /// Process all retired blocks of the ring.
+        void read();
+
+        /// Process the remaining blocks and close the file.
+        void close();
+
+        /// The socket becomes readable when the ring has retired blocks.
+        inline const sys::fildes& in() const noexcept { return this->_socket; }
+        inline const std::vector<traffic_summary>& summaries() const noexcept {
+            return this->_summaries;
+        }
+        /// The number of frames that the kernel dropped because the ring was full.
+        inline std::uint64_t dropped() const noexcept { return this->_dropped; }
+
+        inline explicit operator bool() const noexcept { return this->_ring != nullptr; }
+        inline bool operator!() const noexcept { return !this->operator bool(); }
+
+    private:
+        void frame(const char* data, std::uint32_t size, std::uint32_t length,
+                   std::uint64_t nanoseconds);
+        void write_header(int interface_index);
+        void write(const void* data, size_t size);
+
+    };
+
+}
+
+#endif // vim:filetype=cpp
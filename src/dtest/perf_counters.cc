@@ -0,0 +1,101 @@
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <ostream>
+#include <system_error>
+
+#include <dtest/perf_counters.hh>
+
+namespace {
+
+    struct counter_config {
+        std::uint32_t type;
+        std::uint64_t config;
+    };
+
+    constexpr const counter_config all_counters[dts::num_perf_counters] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+        {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+    };
+
+    constexpr const char* all_names[dts::num_perf_counters] = {
+        "cycles",
+        "instructions",
+        "cache_misses",
+        "context_switches",
+    };
+
+    int open_counter(const counter_config& c, sys::pid_type pid) {
+        ::perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = c.type;
+        attr.config = c.config;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        attr.disabled = 1;
+        attr.enable_on_exec = 1;
+        attr.inherit = 1;
+        // user-space only counting is permitted with the default perf_event_paranoid
+        attr.exclude_kernel = c.type == PERF_TYPE_HARDWARE;
+        attr.exclude_hv = 1;
+        return int(::syscall(SYS_perf_event_open, &attr, pid, -1, -1, PERF_FLAG_FD_CLOEXEC));
+    }
+
+}
+
+const char* dts::to_string(perf_counter c) noexcept {
+    return all_names[size_t(c)];
+}
+
+dts::perf_values& dts::perf_values::operator+=(const perf_values& rhs) noexcept {
+    for (size_t i=0; i<num_perf_counters; ++i) { this->values[i] += rhs.values[i]; }
+    this->available |= rhs.available;
+    return *this;
+}
+
+std::ostream& dts::operator<<(std::ostream& out, const perf_values& rhs) {
+    bool first = true;
+    for (size_t i=0; i<num_perf_counters; ++i) {
+        if (!rhs.has(perf_counter(i))) { continue; }
+        if (!first) { out << ' '; }
+        out << all_names[i] << ' ' << rhs.values[i];
+        first = false;
+    }
+    if (first) { out << "unavailable"; }
+    return out;
+}
+
+dts::perf_counters::perf_counters(sys::pid_type pid) {
+    for (size_t i=0; i<num_perf_counters; ++i) {
+        int fd = open_counter(all_counters[i], pid);
+        if (fd == -1) {
+            if (errno == EMFILE || errno == ENFILE || errno == ENOMEM) {
+                throw std::system_error(errno, std::generic_category());
+            }
+            continue;
+        }
+        this->_counters[i] = sys::fildes(fd);
+    }
+}
+
+dts::perf_values dts::perf_counters::read() const {
+    perf_values result;
+    for (size_t i=0; i<num_perf_counters; ++i) {
+        const auto& fd = this->_counters[i];
+        if (!fd) { continue; }
+        // value, time enabled, time running
+        std::uint64_t buf[3]{};
+        if (fd.read(buf, sizeof(buf)) != sizeof(buf)) { continue; }
+        if (buf[2] != 0 && buf[2] != buf[1]) {
+            buf[0] = std::uint64_t(double(buf[0])*double(buf[1])/double(buf[2]));
+        }
+        result.values[i] = buf[0];
+        result.available |= 1u << i;
+    }
+    return result;
+}
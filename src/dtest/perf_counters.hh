@@ -0,0 +1,68 @@
+#ifndef DTEST_PERF_COUNTERS_HH
+#define DTEST_PERF_COUNTERS_HH
+
+#include <array>
+#include <cstdint>
+#include <iosfwd>
+
+#include <unistdx/io/fildes>
+#include <unistdx/ipc/process>
+
+namespace dts {
+
+    enum class perf_counter {
+        cycles,
+        instructions,
+        cache_misses,
+        context_switches,
+    };
+
+    constexpr const size_t num_perf_counters = 4;
+
+    /// Counter name as it is reported (e.g. "cache_misses").
+    const char* to_string(perf_counter c) noexcept;
+
+    /// Values of performance counters of one or more processes.
+    struct perf_values {
+        std::array<std::uint64_t,num_perf_counters> values{};
+        /// Bit i is set if i-th counter was opened for at least one process.
+        unsigned available = 0;
+
+        inline std::uint64_t operator[](perf_counter c) const noexcept {
+            return this->values[size_t(c)];
+        }
+
+        inline bool has(perf_counter c) const noexcept {
+            return (this->available & (1u << size_t(c))) != 0;
+        }
+
+        perf_values& operator+=(const perf_values& rhs) noexcept;
+    };
+
+    /// Print the available counters as name-value pairs separated by spaces.
+    std::ostream& operator<<(std::ostream& out, const perf_values& rhs);
+
+    /**
+    \brief Performance counters of the child process and all its descendants.
+    \details The counters are opened via perf_event_open(2) before the child
+    executes the command and are enabled on exec. The counts of the descendants
+    are added when they terminate. The counters that are not supported by the
+    hardware or are not permitted by the kernel are silently skipped.
+    */
+    class perf_counters {
+
+    private:
+        std::array<sys::fildes,num_perf_counters> _counters;
+
+    public:
+        perf_counters() = default;
+        explicit perf_counters(sys::pid_type pid);
+
+        /// Current values of the counters scaled by the time they were multiplexed.
+        perf_values read() const;
+
+    };
+
+}
+
+#endif // vim:filetype=cpp
@@ -1,6 +1,12 @@
+#include <atomic>
+#include <chrono>
+#include <csignal>
 #include <cstdio>
 #include <iostream>
 #include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
 #include <vector>
 
 #include <dtest/application.hh>
@@ -46,6 +52,15 @@ namespace {
                 "Use this function to simulate cluster node failure. "
                 "The signal is configurable."
         },
+        {
+            .ml_name = "restart_node",
+            .ml_meth = (PyCFunction) dts::python::restart_node,
+            .ml_flags = METH_VARARGS | METH_KEYWORDS,
+            .ml_doc = "Kill every process running on the specified node with the signal "
+                "(SIGKILL by default), wait for the delay in seconds and run the same "
+                "processes again in the existing node namespaces. "
+                "Use this function to simulate node crash and recovery."
+        },
         {
             .ml_name = "add_test",
             .ml_meth = (PyCFunction) dts::python::add_test,
@@ -53,8 +68,18 @@ namespace {
             .ml_doc = "Add unit test that checks output of all processes. "
                 "Dtest colects stderr/stdout output from every process in the cluster and "
                 "prepends node name to each line. "
+                "The test function receives dtest.Lines object that is valid only "
+                "inside the function and has the same interface as read-only list. "
                 "Finding specific lines or specific sequence of lines allows to check "
-                "events that occur in the application."
+                "events that occur in the application. "
+                "Optional argument \"depends\" is the list of descriptions of "
+                "the tests that have to succeed before this test is evaluated "
+                "(when the tests are evaluated concurrently). "
+                "Optional argument \"triggers\" is the list of regular expressions: "
+                "the test is evaluated again only when new lines match any of them. "
+                "Optional argument \"timeout\" is the number of seconds after which the test "
+                "fails; the time is counted from the moment the previous tests "
+                "(or the dependencies) succeeded."
         },
         {
             .ml_name = "will_restart",
@@ -80,12 +105,104 @@ namespace {
             .ml_doc = "Process execution delay in milliseconds. "
                 "The amount of time between execution of the processes on the successive nodes. "
         },
+        {
+            .ml_name = "metrics",
+            .ml_meth = (PyCFunction) dts::python::metrics,
+            .ml_flags = METH_VARARGS,
+            .ml_doc = "Print dtest self-metrics (lines and bytes per stream, poller wakeups, "
+                "time spent copying output and running tests) when the tests finish."
+        },
+        {
+            .ml_name = "stats_file",
+            .ml_meth = (PyCFunction) dts::python::stats_file,
+            .ml_flags = METH_VARARGS,
+            .ml_doc = "Periodically write dtest self-metrics to the specified file "
+                "while the cluster runs."
+        },
+        {
+            .ml_name = "retention",
+            .ml_meth = (PyCFunction) dts::python::retention,
+            .ml_flags = METH_VARARGS | METH_KEYWORDS,
+            .ml_doc = "Limit the memory occupied by captured lines to max_memory megabytes. "
+                "Older lines are moved to memory-mapped temporary file. "
+                "If filter regular expression is specified, only matching lines are retained "
+                "in the file."
+        },
+        {
+            .ml_name = "buffers",
+            .ml_meth = (PyCFunction) dts::python::buffers,
+            .ml_flags = METH_VARARGS | METH_KEYWORDS,
+            .ml_doc = "Set maximum length of captured lines in bytes (keyword argument "
+                "max_line_length, longer lines are truncated) and capacity of "
+                "child process output pipes in bytes (keyword argument pipe_size)."
+        },
+        {
+            .ml_name = "timeout",
+            .ml_meth = (PyCFunction) dts::python::timeout,
+            .ml_flags = METH_VARARGS,
+            .ml_doc = "Fail the tests and terminate the processes if the tests do not "
+                "succeed in the specified number of seconds."
+        },
+        {
+            .ml_name = "test_threads",
+            .ml_meth = (PyCFunction) dts::python::test_threads,
+            .ml_flags = METH_VARARGS,
+            .ml_doc = "Evaluate independent tests concurrently in the specified number of "
+                "threads. Dependencies are specified by \"depends\" argument of add_test."
+        },
+        {
+            .ml_name = "readers",
+            .ml_meth = (PyCFunction) dts::python::readers,
+            .ml_flags = METH_VARARGS,
+            .ml_doc = "Read the output of the processes in the specified number of threads."
+        },
+        {
+            .ml_name = "zero_copy",
+            .ml_meth = (PyCFunction) dts::python::zero_copy,
+            .ml_flags = METH_VARARGS,
+            .ml_doc = "Forward the output of the processes with splice instead of writing it "
+                "from user space (the lines are still read for matching). "
+                "The forwarded lines are not prefixed with node names."
+        },
+        {
+            .ml_name = "event_ring",
+            .ml_meth = (PyCFunction) dts::python::event_ring,
+            .ml_flags = METH_VARARGS | METH_KEYWORDS,
+            .ml_doc = "Pass binary events via shared memory ring of the specified size "
+                "in kilobytes instead of the pipe. Keyword argument \"watermark\" "
+                "specifies the number of bytes in the ring that wakes up dtest."
+        },
+        {
+            .ml_name = "tmpfs",
+            .ml_meth = (PyCFunction) dts::python::tmpfs,
+            .ml_flags = METH_VARARGS | METH_KEYWORDS,
+            .ml_doc = "Mount private tmpfs at the specified path on every node. "
+                "Keyword argument \"size\" limits the size of each tmpfs in megabytes. "
+                "The contents are discarded when the tests finish, and the directory "
+                "is removed if dtest created it. "
+                "Processes whose working directory is under the path start in the root directory."
+        },
         {
             .ml_name = "run",
             .ml_meth = (PyCFunction) dts::python::run,
             .ml_flags = METH_VARARGS,
             .ml_doc = "Run test suite."
         },
+        {
+            .ml_name = "record",
+            .ml_meth = (PyCFunction) dts::python::record,
+            .ml_flags = METH_VARARGS,
+            .ml_doc = "Write output of all processes to the specified file "
+                "(compressed if the file name ends with .gz)."
+        },
+        {
+            .ml_name = "replay",
+            .ml_meth = (PyCFunction) dts::python::replay,
+            .ml_flags = METH_VARARGS,
+            .ml_doc = "Run test suite against the output recorded in the specified file "
+                "without launching any processes. Raises ValueError if the file "
+                "is not a recording or has unsupported version."
+        },
         {
             .ml_name = "fail",
             .ml_meth = (PyCFunction) dts::python::fail,
@@ -97,7 +214,119 @@ namespace {
             .ml_meth = (PyCFunction) dts::python::expect_event_sequence,
             .ml_flags = METH_VARARGS | METH_KEYWORDS,
             .ml_doc = "Check that the specified sequence of events ocurred in the processes. "
-                "Events are specified as regular expressions (strings)."
+                "Events are specified as regular expressions (strings). "
+                "dtest.Lines are matched in C++ without converting them to Python strings."
+        },
+        {
+            .ml_name = "expect_event_count",
+            .ml_meth = (PyCFunction) dts::python::expect_event_count,
+            .ml_flags = METH_VARARGS | METH_KEYWORDS,
+            .ml_doc = "Check that the number of lines that match the regular expression "
+                "equals the expected count. Arguments: lines, regex, count."
+        },
+        {
+            .ml_name = "events",
+            .ml_meth = (PyCFunction) dts::python::events,
+            .ml_flags = METH_NOARGS,
+            .ml_doc = "Binary events emitted by the processes via event channel "
+                "as a list of (timestamp, node, id, payload) tuples."
+        },
+        {
+            .ml_name = "expect_events",
+            .ml_meth = (PyCFunction) dts::python::expect_events,
+            .ml_flags = METH_VARARGS,
+            .ml_doc = "Check that the specified sequence of binary events ocurred in "
+                "the processes. Events are specified as identifiers or (id, node) tuples."
+        },
+        {
+            .ml_name = "expect_event_id_count",
+            .ml_meth = (PyCFunction) dts::python::expect_event_id_count,
+            .ml_flags = METH_VARARGS | METH_KEYWORDS,
+            .ml_doc = "Check that binary event with the specified identifier "
+                "ocurred exactly the specified number of times (optionally on the specified node)."
+        },
+        {
+            .ml_name = "expect_latency",
+            .ml_meth = (PyCFunction) dts::python::expect_latency,
+            .ml_flags = METH_VARARGS | METH_KEYWORDS,
+            .ml_doc = "Check that the first end event that follows the first start event "
+                "occurs not later than the specified number of milliseconds. "
+                "Arguments: lines, start regex, end regex, max. milliseconds."
+        },
+        {
+            .ml_name = "expect_latency_percentiles",
+            .ml_meth = (PyCFunction) dts::python::expect_latency_percentiles,
+            .ml_flags = METH_VARARGS | METH_KEYWORDS,
+            .ml_doc = "Pair start and end events by the first capture group of "
+                "the regular expressions (e.g. request id) and check that 50th, "
+                "99th percentiles and maximum of the latencies (keyword arguments "
+                "p50, p99, max in milliseconds) are not exceeded."
+        },
+        {
+            .ml_name = "extract",
+            .ml_meth = (PyCFunction) dts::python::extract,
+            .ml_flags = METH_VARARGS | METH_KEYWORDS,
+            .ml_doc = "Extract numeric capture groups of the regular expression from "
+                "the captured lines (optionally only the lines of the specified node). "
+                "Fields label capture groups 1..n in order: each field is either a name "
+                "(parsed as float) or (name, int|float) pair; by default all groups are "
+                "floats named by their numbers. Returns dict of memoryviews: 'node', 'timestamp' "
+                "(seconds, the same clock as time.monotonic()) and one column per field."
+        },
+        {
+            .ml_name = "perf_counters",
+            .ml_meth = (PyCFunction) dts::python::perf_counters,
+            .ml_flags = METH_VARARGS,
+            .ml_doc = "Count cycles, instructions, cache misses and context switches "
+                "of every process (and its descendants) and print them when the tests finish."
+        },
+        {
+            .ml_name = "counters",
+            .ml_meth = (PyCFunction) dts::python::counters,
+            .ml_flags = METH_VARARGS | METH_KEYWORDS,
+            .ml_doc = "Return dict of performance counters summed over the processes of the "
+                "specified node and the specified process (the index of add_process call) "
+                "or over all processes. Counters that are not supported are omitted."
+        },
+        {
+            .ml_name = "capture",
+            .ml_meth = (PyCFunction) dts::python::capture,
+            .ml_flags = METH_VARARGS | METH_KEYWORDS,
+            .ml_doc = "Capture the frames that pass through the cluster bridge, count them "
+                "per node and optionally write them to the specified pcapng file."
+        },
+        {
+            .ml_name = "traffic",
+            .ml_meth = (PyCFunction) dts::python::traffic,
+            .ml_flags = METH_VARARGS | METH_KEYWORDS,
+            .ml_doc = "Return dict with the number of packets and bytes that the specified "
+                "node (or all nodes) sent and received via the cluster bridge."
+        },
+        {
+            .ml_name = "event",
+            .ml_meth = (PyCFunction) dts::python::event,
+            .ml_flags = METH_VARARGS | METH_KEYWORDS,
+            .ml_doc = "Return awaitable that resolves to the first line that matches "
+                "the regular expression (optionally only the lines of the specified node). "
+                "The lines are matched after the line that resolved the previous awaitable. "
+                "Raises asyncio.TimeoutError when timeout in seconds is exceeded. "
+                "Use it in coroutine tests."
+        },
+        {
+            .ml_name = "sequence",
+            .ml_meth = (PyCFunction) dts::python::sequence,
+            .ml_flags = METH_VARARGS | METH_KEYWORDS,
+            .ml_doc = "Return awaitable that resolves to the list of lines that match "
+                "the regular expressions in order. Accepts the same keyword arguments "
+                "as event()."
+        },
+        {
+            .ml_name = "exited",
+            .ml_meth = (PyCFunction) dts::python::exited,
+            .ml_flags = METH_VARARGS | METH_KEYWORDS,
+            .ml_doc = "Return awaitable that resolves to the list of exit codes "
+                "(negative signal numbers for killed processes) when every process "
+                "running on the specified nodes exits."
         },
         {nullptr, nullptr, 0, nullptr}
     };
@@ -110,8 +339,208 @@ namespace {
         .m_methods = dts_methods
     };
 
+    /// Python view of the lines captured by dtest. The view is valid only
+    /// inside the test function, because the lines are modified by dtest
+    /// between the calls.
+    struct line_view {
+        PyObject_HEAD
+        const dts::line_array* lines;
+    };
+
+    PyTypeObject* line_view_type = nullptr;
+
+    const dts::line_array* get_lines(PyObject* self) {
+        auto lines = reinterpret_cast<line_view*>(self)->lines;
+        if (!lines) {
+            PyErr_SetString(PyExc_RuntimeError, "lines are accessed outside of the test");
+        }
+        return lines;
+    }
+
+    bool get_line_index(const dts::line_array& lines, Py_ssize_t& i) {
+        const Py_ssize_t n = lines.size();
+        if (i < 0) { i += n; }
+        if (i < 0 || i >= n) {
+            PyErr_SetString(PyExc_IndexError, "line index out of range");
+            return false;
+        }
+        return true;
+    }
+
+    const dts::line_array* object_to_line_array(PyObject* py_lines) {
+        if (!PyObject_TypeCheck(py_lines, line_view_type)) {
+            PyErr_SetString(PyExc_TypeError, "expected dtest.Lines");
+            return nullptr;
+        }
+        return get_lines(py_lines);
+    }
+
+    inline dts::latency_type milliseconds_to_latency(double ms) {
+        using milliseconds = std::chrono::duration<double,std::milli>;
+        return std::chrono::duration_cast<dts::latency_type>(milliseconds(ms));
+    }
+
+    inline dts::line_info::clock_type::duration seconds_to_duration(double s) {
+        using seconds = std::chrono::duration<double>;
+        return std::chrono::duration_cast<dts::line_info::clock_type::duration>(seconds(s));
+    }
+
+    /// Render the line with its prefix.
+    inline PyObject* line_to_object(const dts::line& line) {
+        const auto s = line.str();
+        return PyUnicode_FromStringAndSize(s.data(), s.size());
+    }
+
+    void line_view_dealloc(PyObject* self) {
+        auto type = Py_TYPE(self);
+        type->tp_free(self);
+        Py_DECREF(type);
+    }
+
+    Py_ssize_t line_view_length(PyObject* self) {
+        auto lines = get_lines(self);
+        if (!lines) { return -1; }
+        return lines->size();
+    }
+
+    PyObject* line_view_item(PyObject* self, Py_ssize_t i) {
+        auto lines = get_lines(self);
+        if (!lines || !get_line_index(*lines, i)) { return nullptr; }
+        return line_to_object((*lines)[i]);
+    }
+
+    PyObject* line_view_subscript(PyObject* self, PyObject* key) {
+        auto lines = get_lines(self);
+        if (!lines) { return nullptr; }
+        if (PySlice_Check(key)) {
+            Py_ssize_t start = 0, stop = 0, step = 0;
+            if (PySlice_Unpack(key, &start, &stop, &step) == -1) { return nullptr; }
+            const auto n = PySlice_AdjustIndices(lines->size(), &start, &stop, step);
+            PyObject* result = PyList_New(n);
+            if (!result) { return nullptr; }
+            for (Py_ssize_t i=0; i<n; ++i, start += step) {
+                PyList_SET_ITEM(result, i, line_to_object((*lines)[start]));
+            }
+            return result;
+        }
+        Py_ssize_t i = PyNumber_AsSsize_t(key, PyExc_IndexError);
+        if (i == -1 && PyErr_Occurred()) { return nullptr; }
+        return line_view_item(self, i);
+    }
+
+    PyObject* line_view_timestamp(PyObject* self, PyObject* args) {
+        Py_ssize_t i = 0;
+        if (!PyArg_ParseTuple(args, "n", &i)) { return nullptr; }
+        auto lines = get_lines(self);
+        if (!lines || !get_line_index(*lines, i)) { return nullptr; }
+        using seconds = std::chrono::duration<double>;
+        const auto t = lines->timestamp(i).time_since_epoch();
+        return PyFloat_FromDouble(std::chrono::duration_cast<seconds>(t).count());
+    }
+
+    PyObject* line_view_stream(PyObject* self, PyObject* args) {
+        Py_ssize_t i = 0;
+        if (!PyArg_ParseTuple(args, "n", &i)) { return nullptr; }
+        auto lines = get_lines(self);
+        if (!lines || !get_line_index(*lines, i)) { return nullptr; }
+        return PyLong_FromUnsignedLong(lines->info(i).stream);
+    }
+
+    PyObject* line_view_sequence(PyObject* self, PyObject* args) {
+        Py_ssize_t i = 0;
+        if (!PyArg_ParseTuple(args, "n", &i)) { return nullptr; }
+        auto lines = get_lines(self);
+        if (!lines || !get_line_index(*lines, i)) { return nullptr; }
+        return PyLong_FromUnsignedLongLong(lines->info(i).sequence);
+    }
+
+    PyObject* line_view_ordered(PyObject* self, PyObject*) {
+        auto lines = get_lines(self);
+        if (!lines) { return nullptr; }
+        const auto indices = lines->ordered();
+        const Py_ssize_t n = indices.size();
+        PyObject* result = PyList_New(n);
+        if (!result) { return nullptr; }
+        for (Py_ssize_t i=0; i<n; ++i) {
+            PyList_SET_ITEM(result, i, PyLong_FromSize_t(indices[i]));
+        }
+        return result;
+    }
+
+    PyMethodDef line_view_methods[] = {
+        {
+            .ml_name = "timestamp",
+            .ml_meth = (PyCFunction) line_view_timestamp,
+            .ml_flags = METH_VARARGS,
+            .ml_doc = "The time in seconds when the line was read by dtest. "
+                "Uses the same clock as time.monotonic()."
+        },
+        {
+            .ml_name = "stream",
+            .ml_meth = (PyCFunction) line_view_stream,
+            .ml_flags = METH_VARARGS,
+            .ml_doc = "The index of the stream (stdout or stderr of a particular process) "
+                "the line was read from."
+        },
+        {
+            .ml_name = "sequence",
+            .ml_meth = (PyCFunction) line_view_sequence,
+            .ml_flags = METH_VARARGS,
+            .ml_doc = "Line number within its stream starting from nought."
+        },
+        {
+            .ml_name = "ordered",
+            .ml_meth = (PyCFunction) line_view_ordered,
+            .ml_flags = METH_NOARGS,
+            .ml_doc = "Line indices ordered by timestamp (merged view of all streams)."
+        },
+        {nullptr, nullptr, 0, nullptr}
+    };
+
+    PyType_Slot line_view_slots[] = {
+        {Py_tp_doc, const_cast<char*>("Lines captured from all processes in the cluster.")},
+        {Py_tp_dealloc, reinterpret_cast<void*>(line_view_dealloc)},
+        {Py_tp_methods, line_view_methods},
+        {Py_sq_length, reinterpret_cast<void*>(line_view_length)},
+        {Py_sq_item, reinterpret_cast<void*>(line_view_item)},
+        {Py_mp_length, reinterpret_cast<void*>(line_view_length)},
+        {Py_mp_subscript, reinterpret_cast<void*>(line_view_subscript)},
+        {0, nullptr}
+    };
+
+    PyType_Spec line_view_spec = {
+        .name = "dtest.Lines",
+        .basicsize = sizeof(line_view),
+        .itemsize = 0,
+        .flags = Py_TPFLAGS_DEFAULT,
+        .slots = line_view_slots
+    };
+
+    /// Invalidates the view when the test function returns or throws.
+    class line_view_guard {
+    private:
+        ::python::object _view;
+    public:
+        inline explicit line_view_guard(const dts::line_array& lines):
+        _view(reinterpret_cast<PyObject*>(PyObject_New(line_view, line_view_type))) {
+            if (this->_view) { reinterpret_cast<line_view*>(this->_view.get())->lines = &lines; }
+        }
+        inline ~line_view_guard() noexcept {
+            if (this->_view) { reinterpret_cast<line_view*>(this->_view.get())->lines = nullptr; }
+        }
+        inline PyObject* get() noexcept { return this->_view.get(); }
+        line_view_guard(const line_view_guard&) = delete;
+        line_view_guard& operator=(const line_view_guard&) = delete;
+    };
+
     PyMODINIT_FUNC dts_init() {
-        return PyModule_Create(&dts_module);
+        PyObject* module = PyModule_Create(&dts_module);
+        if (!module) { return nullptr; }
+        line_view_type = reinterpret_cast<PyTypeObject*>(PyType_FromSpec(&line_view_spec));
+        if (!line_view_type) { Py_DECREF(module); return nullptr; }
+        Py_INCREF(line_view_type);
+        PyModule_AddObject(module, "Lines", reinterpret_cast<PyObject*>(line_view_type));
+        return module;
     }
 
     constexpr const char* cluster_keywords[] = {
@@ -123,9 +552,458 @@ namespace {
 
     constexpr const char* add_process_keywords[] = {"nodes", "args", nullptr};
 
+    constexpr const char* restart_node_keywords[] = {"nodes", "signal", "delay", nullptr};
+
+    constexpr const char* retention_keywords[] = {"max_memory", "filter", nullptr};
+
+    constexpr const char* buffers_keywords[] = {"max_line_length", "pipe_size", nullptr};
+
+    constexpr const char* expect_latency_keywords[] = {
+        "lines",
+        "start",
+        "end",
+        "max",
+        nullptr};
+
+    constexpr const char* expect_latency_percentiles_keywords[] = {
+        "lines",
+        "start",
+        "end",
+        "p50",
+        "p99",
+        "max",
+        nullptr};
+
+    constexpr const char* event_ring_keywords[] = {
+        "size",
+        "watermark",
+        nullptr};
+
+    constexpr const char* tmpfs_keywords[] = {
+        "path",
+        "size",
+        nullptr};
+
+    constexpr const char* expect_event_id_count_keywords[] = {
+        "id",
+        "count",
+        "node",
+        nullptr};
+
+    constexpr const char* add_test_keywords[] = {
+        "description",
+        "function",
+        "depends",
+        "triggers",
+        "timeout",
+        nullptr};
+
+    constexpr const char* expect_event_count_keywords[] = {"lines", "regex", "count", nullptr};
+
+    constexpr const char* extract_keywords[] = {"regex", "fields", "node", nullptr};
+
+    constexpr const char* counters_keywords[] = {"node", "process", nullptr};
+
+    constexpr const char* capture_keywords[] = {"filename", nullptr};
+
+    constexpr const char* traffic_keywords[] = {"node", nullptr};
+
+    constexpr const char* event_keywords[] = {"regex", "node", "timeout", nullptr};
+
+    constexpr const char* sequence_keywords[] = {"regexes", "node", "timeout", nullptr};
+
+    constexpr const char* exited_keywords[] = {"nodes", "timeout", nullptr};
+
     dts::application* python_application = nullptr;
     int python_exit_code = 0;
 
+    /// The event loop that runs coroutine tests (created in the application process).
+    PyObject* python_loop = nullptr;
+    std::string python_loop_error;
+
+    /// Awaited lines are matched after the line that resolved the previous awaitable
+    /// of the same coroutine test. The cursor stores line position that, unlike the index,
+    /// does not change when the lines are discarded by the retention filter.
+    using line_cursor = std::atomic<dts::line_array::size_type>;
+    using line_cursor_ptr = std::shared_ptr<line_cursor>;
+    using trigger_flag_ptr = dts::test::trigger_flag_ptr;
+    constexpr const char* line_cursor_name = "dtest.line_cursor";
+    constexpr const char* trigger_flag_name = "dtest.trigger_flag";
+    /// Context variable that holds the cursor of the current coroutine test
+    /// (inherited by the tasks that the test creates).
+    PyObject* python_line_cursor = nullptr;
+    /// Coroutine that sets the context variable and awaits the test function.
+    PyObject* python_run_with_cursor = nullptr;
+    /// Trigger flags of coroutine tests that are set when the event loop stops.
+    std::vector<trigger_flag_ptr> python_trigger_flags;
+
+    constexpr const char* run_with_cursor_source =
+        "async def run_with_cursor(variable, cursor, function):\n"
+        "    variable.set(cursor)\n"
+        "    return await function()\n";
+
+    template <class T>
+    void destroy_capsule(PyObject* capsule) {
+        delete static_cast<std::shared_ptr<T>*>(
+            PyCapsule_GetPointer(capsule, PyCapsule_GetName(capsule)));
+    }
+
+    template <class T>
+    PyObject* make_capsule(std::shared_ptr<T> ptr, const char* name) {
+        return PyCapsule_New(new std::shared_ptr<T>(std::move(ptr)), name, destroy_capsule<T>);
+    }
+
+    /// \return the cursor of the current coroutine test or nullptr outside of the tests
+    line_cursor_ptr current_line_cursor() {
+        if (!python_line_cursor) { return nullptr; }
+        PyObject* value = nullptr;
+        if (PyContextVar_Get(python_line_cursor, nullptr, &value) == -1) {
+            PyErr_Clear();
+            return nullptr;
+        }
+        ::python::object tmp(value);
+        if (!value) { return nullptr; }
+        auto ptr = static_cast<line_cursor_ptr*>(PyCapsule_GetPointer(value, line_cursor_name));
+        if (!ptr) { PyErr_Clear(); return nullptr; }
+        return *ptr;
+    }
+
+    /// Move the cursor forward to \p position (the cursor never moves back).
+    inline void advance(line_cursor& cursor, dts::line_array::size_type position) {
+        auto old = cursor.load();
+        while (old < position && !cursor.compare_exchange_weak(old, position)) {}
+    }
+
+    std::string fetch_python_error() {
+        PyObject* type = nullptr;
+        PyObject* value = nullptr;
+        PyObject* traceback = nullptr;
+        PyErr_Fetch(&type, &value, &traceback);
+        PyErr_NormalizeException(&type, &value, &traceback);
+        ::python::object py_type(type), py_value(value), py_traceback(traceback);
+        std::string what = "Python exception";
+        ::python::object repr = PyObject_Repr(value ? value : type);
+        if (repr) {
+            if (const char* s = PyUnicode_AsUTF8(repr.get())) { what = s; }
+        }
+        PyErr_Clear();
+        return what;
+    }
+
+    [[noreturn]] void throw_python_error() {
+        throw std::runtime_error(fetch_python_error());
+    }
+
+    PyObject* resolve_future(PyObject*, PyObject* args) {
+        PyObject* future = nullptr;
+        PyObject* value = nullptr;
+        if (!PyArg_ParseTuple(args, "OO", &future, &value)) { return nullptr; }
+        // the future is cancelled on timeout
+        ::python::object done = PyObject_CallMethod(future, "done", nullptr);
+        if (!done) { return nullptr; }
+        if (!PyObject_IsTrue(done.get())) {
+            ::python::object result = PyObject_CallMethod(future, "set_result", "O", value);
+            if (!result) { return nullptr; }
+        }
+        Py_RETURN_NONE;
+    }
+
+    PyObject* cancel_waiter(PyObject* self, PyObject*) {
+        const size_t id = PyLong_AsSize_t(self);
+        {
+            ::python::gil_release g;
+            python_application->cancel_waiter(id);
+        }
+        Py_RETURN_NONE;
+    }
+
+    /// Set the trigger flag of the coroutine test when the coroutine completes.
+    PyObject* complete_coroutine(PyObject* self, PyObject*) {
+        auto ptr = static_cast<trigger_flag_ptr*>(PyCapsule_GetPointer(self, trigger_flag_name));
+        if (!ptr) { return nullptr; }
+        (*ptr)->store(true);
+        python_application->wakeup();
+        Py_RETURN_NONE;
+    }
+
+    PyMethodDef resolve_future_def = {
+        .ml_name = "_resolve_future",
+        .ml_meth = (PyCFunction) resolve_future,
+        .ml_flags = METH_VARARGS,
+        .ml_doc = nullptr
+    };
+
+    PyMethodDef cancel_waiter_def = {
+        .ml_name = "_cancel_waiter",
+        .ml_meth = (PyCFunction) cancel_waiter,
+        .ml_flags = METH_O,
+        .ml_doc = nullptr
+    };
+
+    PyMethodDef complete_coroutine_def = {
+        .ml_name = "_complete_coroutine",
+        .ml_meth = (PyCFunction) complete_coroutine,
+        .ml_flags = METH_O,
+        .ml_doc = nullptr
+    };
+
+    /// Asyncio future that is resolved from the output thread.
+    struct python_future {
+        ::python::object loop;
+        ::python::object future;
+
+        python_future() = default;
+        python_future(const python_future&) = delete;
+        python_future& operator=(const python_future&) = delete;
+
+        /// Waiters are destroyed without the GIL.
+        inline ~python_future() noexcept {
+            ::python::gil_guard g;
+            this->future.clear();
+            this->loop.clear();
+        }
+
+        /// Set the result in the loop thread. Called with the GIL locked.
+        inline void resolve(PyObject* value) {
+            ::python::object resolve = PyCFunction_New(&resolve_future_def, nullptr);
+            ::python::object result = PyObject_CallMethod(
+                this->loop.get(), "call_soon_threadsafe", "OOO",
+                resolve.get(), this->future.get(), value);
+            // the loop is already closed
+            if (!result) { PyErr_Clear(); }
+        }
+    };
+
+    using python_future_ptr = std::shared_ptr<python_future>;
+
+    python_future_ptr make_future() {
+        ::python::object asyncio = PyImport_ImportModule("asyncio");
+        if (!asyncio) { return nullptr; }
+        ::python::object loop = PyObject_CallMethod(asyncio.get(), "get_running_loop", nullptr);
+        if (!loop) { return nullptr; }
+        ::python::object future = PyObject_CallMethod(loop.get(), "create_future", nullptr);
+        if (!future) { return nullptr; }
+        python_future_ptr result(new python_future);
+        result->loop = std::move(loop);
+        result->future = std::move(future);
+        return result;
+    }
+
+    /// Cancel the waiter when the future is done (e.g. on timeout)
+    /// and wrap the future with asyncio.wait_for if \p timeout is specified.
+    PyObject* await_future(python_future& f, size_t id, PyObject* timeout) {
+        ::python::object py_id = PyLong_FromSize_t(id);
+        ::python::object cancel = PyCFunction_New(&cancel_waiter_def, py_id.get());
+        if (!cancel) { return nullptr; }
+        ::python::object result =
+            PyObject_CallMethod(f.future.get(), "add_done_callback", "O", cancel.get());
+        if (!result) { return nullptr; }
+        if (!timeout || timeout == Py_None) {
+            f.future.retain();
+            return f.future.get();
+        }
+        ::python::object asyncio = PyImport_ImportModule("asyncio");
+        if (!asyncio) { return nullptr; }
+        return PyObject_CallMethod(asyncio.get(), "wait_for", "OO", f.future.get(), timeout);
+    }
+
+    void start_event_loop() {
+        python_line_cursor = PyContextVar_New("dtest_line_cursor", nullptr);
+        if (!python_line_cursor) { throw_python_error(); }
+        {
+            ::python::object globals = PyDict_New();
+            if (!globals) { throw_python_error(); }
+            if (PyDict_SetItemString(globals.get(), "__builtins__", PyEval_GetBuiltins()) != 0) {
+                throw_python_error();
+            }
+            ::python::object result = PyRun_String(run_with_cursor_source, Py_file_input,
+                                                   globals.get(), globals.get());
+            if (!result) { throw_python_error(); }
+            python_run_with_cursor = PyDict_GetItemString(globals.get(), "run_with_cursor");
+            if (!python_run_with_cursor) { throw_python_error(); }
+            Py_INCREF(python_run_with_cursor);
+        }
+        ::python::object asyncio = PyImport_ImportModule("asyncio");
+        if (!asyncio) { throw_python_error(); }
+        ::python::object loop = PyObject_CallMethod(asyncio.get(), "new_event_loop", nullptr);
+        if (!loop) { throw_python_error(); }
+        loop.retain();
+        python_loop = loop.get();
+        // the loop runs until the application process exits
+        std::thread([] () {
+            ::python::gil_guard g;
+            try {
+                ::python::object asyncio = PyImport_ImportModule("asyncio");
+                ::python::object result;
+                if (asyncio) {
+                    result = PyObject_CallMethod(asyncio.get(), "set_event_loop", "O", python_loop);
+                }
+                if (result) { result = PyObject_CallMethod(python_loop, "run_forever", nullptr); }
+                if (!result) { python_loop_error = fetch_python_error(); }
+            } catch (const std::exception& err) {
+                python_loop_error = err.what();
+            }
+            if (python_loop_error.empty()) { python_loop_error = "event loop stopped"; }
+            // report the error in every coroutine test
+            for (auto& flag : python_trigger_flags) { flag->store(true); }
+            python_application->wakeup();
+        }).detach();
+    }
+
+    /// Runs coroutine function on the event loop. The test succeeds
+    /// when the coroutine returns and fails when it raises an exception.
+    struct coroutine_test {
+        ::python::object function;
+        ::python::object future;
+        /// Set when the coroutine completes (the test is evaluated only then).
+        trigger_flag_ptr trigger = std::make_shared<std::atomic<bool>>(true);
+
+        void operator()() {
+            ::python::gil_guard g;
+            if (!python_loop) { start_event_loop(); }
+            // cleared before the future is checked, hence the completion is never missed
+            this->trigger->store(false);
+            if (!this->future) {
+                ::python::object cursor =
+                    make_capsule(std::make_shared<line_cursor>(0), line_cursor_name);
+                if (!cursor) { throw_python_error(); }
+                ::python::object coroutine = PyObject_CallFunctionObjArgs(
+                    python_run_with_cursor, python_line_cursor, cursor.get(),
+                    this->function.get(), nullptr);
+                if (!coroutine) { throw_python_error(); }
+                ::python::object asyncio = PyImport_ImportModule("asyncio");
+                if (!asyncio) { throw_python_error(); }
+                ::python::object f = PyObject_CallMethod(
+                    asyncio.get(), "run_coroutine_threadsafe", "OO",
+                    coroutine.get(), python_loop);
+                if (!f) { throw_python_error(); }
+                // re-evaluate the test as soon as the coroutine completes
+                ::python::object flag = make_capsule(this->trigger, trigger_flag_name);
+                if (!flag) { throw_python_error(); }
+                ::python::object callback = PyCFunction_New(&complete_coroutine_def, flag.get());
+                if (!callback) { throw_python_error(); }
+                ::python::object result =
+                    PyObject_CallMethod(f.get(), "add_done_callback", "O", callback.get());
+                if (!result) { throw_python_error(); }
+                this->future = std::move(f);
+                python_trigger_flags.emplace_back(this->trigger);
+            }
+            ::python::object done = PyObject_CallMethod(this->future.get(), "done", nullptr);
+            if (!done) { throw_python_error(); }
+            if (!PyObject_IsTrue(done.get())) {
+                if (!python_loop_error.empty()) { throw std::runtime_error(python_loop_error); }
+                throw dts::test_pending();
+            }
+            ::python::object error = PyObject_CallMethod(this->future.get(), "exception", nullptr);
+            if (!error) { throw_python_error(); }
+            if (error.get() != Py_None) {
+                ::python::object repr = PyObject_Repr(error.get());
+                const char* s = repr ? PyUnicode_AsUTF8(repr.get()) : nullptr;
+                if (!s) { throw_python_error(); }
+                throw std::runtime_error(s);
+            }
+        }
+    };
+
+    bool object_to_node(PyObject* py_node, size_t& node) {
+        node = dts::application::any_node;
+        if (!py_node || py_node == Py_None) { return true; }
+        node = PyLong_AsSize_t(py_node);
+        return !PyErr_Occurred();
+    }
+
+    bool object_to_process(PyObject* py_process, size_t& process) {
+        process = dts::application::any_process;
+        if (!py_process || py_process == Py_None) { return true; }
+        process = PyLong_AsSize_t(py_process);
+        return !PyErr_Occurred();
+    }
+
+    bool object_to_field(PyObject* py_field, dts::field& field) {
+        PyObject* py_type = nullptr;
+        if (PyTuple_Check(py_field)) {
+            const char* name = nullptr;
+            if (!PyArg_ParseTuple(py_field, "sO", &name, &py_type)) { return false; }
+            field.name = name;
+        } else {
+            const char* name = PyUnicode_AsUTF8(py_field);
+            if (!name) { return false; }
+            field.name = name;
+        }
+        field.type = dts::field::types::real;
+        if (!py_type || py_type == reinterpret_cast<PyObject*>(&PyFloat_Type)) { return true; }
+        if (py_type == reinterpret_cast<PyObject*>(&PyLong_Type)) {
+            field.type = dts::field::types::integer;
+            return true;
+        }
+        PyErr_SetString(PyExc_ValueError, "field type is neither int nor float");
+        return false;
+    }
+
+    /// Copy the column to the bytes object and return typed memoryview of it.
+    template <class T> PyObject*
+    column_to_memoryview(const std::vector<T>& column, const char* format) {
+        ::python::object bytes = PyBytes_FromStringAndSize(
+            reinterpret_cast<const char*>(column.data()), column.size()*sizeof(T));
+        if (!bytes) { return nullptr; }
+        ::python::object view = PyMemoryView_FromObject(bytes.get());
+        if (!view) { return nullptr; }
+        return PyObject_CallMethod(view.get(), "cast", "s", format);
+    }
+
+    bool add_column(PyObject* dict, const char* name, PyObject* column) {
+        ::python::object tmp = column;
+        return tmp && PyDict_SetItemString(dict, name, tmp.get()) == 0;
+    }
+
+    PyObject* wait_for_lines(dts::string_array regex_strings, PyObject* py_node,
+                             PyObject* timeout, bool sequence) {
+        size_t node = 0;
+        if (!object_to_node(py_node, node)) { return nullptr; }
+        auto f = make_future();
+        if (!f) { return nullptr; }
+        // outside of coroutine tests all lines are matched
+        auto cursor = current_line_cursor();
+        const auto first = cursor ? cursor->load() : 0;
+        auto callback = [f,sequence,cursor] (const dts::string_array& lines,
+                                             dts::line_array::size_type last) {
+            if (cursor) { advance(*cursor, last+1); }
+            ::python::gil_guard g;
+            ::python::object value;
+            if (sequence) {
+                const auto n = lines.size();
+                value = PyList_New(n);
+                for (size_t i=0; value && i<n; ++i) {
+                    const auto& line = lines[i];
+                    PyList_SET_ITEM(value.get(), i,
+                                    PyUnicode_FromStringAndSize(line.data(), line.size()));
+                }
+            } else {
+                const auto& line = lines.front();
+                value = PyUnicode_FromStringAndSize(line.data(), line.size());
+            }
+            if (!value) { PyErr_Clear(); return; }
+            f->resolve(value.get());
+        };
+        size_t id = 0;
+        std::string error;
+        {
+            // the callback locks the GIL while the application mutex is locked
+            ::python::gil_release g;
+            try {
+                id = python_application->wait_for_lines(regex_strings, node, first,
+                                                        std::move(callback));
+            } catch (const std::exception& err) {
+                error = err.what();
+            }
+        }
+        if (!error.empty()) {
+            PyErr_SetString(PyExc_ValueError, error.data());
+            return nullptr;
+        }
+        return await_future(*f, id, timeout);
+    }
+
     inline dts::cluster_node::address_type string_to_network(const char* s) {
         dts::cluster_node::address_type net;
         std::stringstream tmp;
@@ -149,16 +1027,42 @@ namespace {
 
     std::vector<std::string> object_to_string_array(PyObject* py_list) {
         ::python::object py_sequence = PySequence_Fast(py_list, "expected a sequence");
-        const int py_sequence_size = PySequence_Size(py_list);
+        if (!py_sequence) {
+            PyErr_Clear();
+            throw std::invalid_argument("expected a sequence of strings");
+        }
+        const auto n = PySequence_Fast_GET_SIZE(py_sequence.get());
         std::vector<std::string> cpp_list;
-        cpp_list.reserve(py_sequence_size);
-        for (int i=0; i<py_sequence_size; ++i) {
-            ::python::object item = PySequence_Fast_GET_ITEM(py_list, i);
-            cpp_list.emplace_back(PyUnicode_AsUTF8(PyObject_Str(item.get())));
+        cpp_list.reserve(n);
+        for (Py_ssize_t i=0; i<n; ++i) {
+            // borrowed reference
+            auto item = PySequence_Fast_GET_ITEM(py_sequence.get(), i);
+            ::python::object str = PyObject_Str(item);
+            Py_ssize_t size = 0;
+            const char* data = str ? PyUnicode_AsUTF8AndSize(str.get(), &size) : nullptr;
+            if (!data) {
+                PyErr_Clear();
+                throw std::invalid_argument("expected a sequence of strings");
+            }
+            cpp_list.emplace_back(data, size);
         }
         return cpp_list;
     }
 
+    bool object_to_event_pattern(PyObject* py_pattern, dts::event_pattern& pattern) {
+        unsigned long id = 0;
+        long long node = dts::event_pattern::any_node;
+        if (PyTuple_Check(py_pattern)) {
+            if (!PyArg_ParseTuple(py_pattern, "kL", &id, &node)) { return false; }
+        } else {
+            id = PyLong_AsUnsignedLong(py_pattern);
+            if (PyErr_Occurred()) { return false; }
+        }
+        pattern.id = id;
+        pattern.node = node;
+        return true;
+    }
+
     PyObject* get_nodes_and_arguments(PyObject* args, PyObject* kwds,
                                       dts::cluster_node_bitmap& cpp_nodes,
                                       sys::argstream& cpp_args) {
@@ -225,7 +1129,8 @@ PyObject* dts::python::cluster(PyObject* self, PyObject* args, PyObject* kwds) {
         return nullptr;
     }
     dts::cluster c;
-    c.name(name);
+    c.read_environment();
+    if (name) { c.name(name); }
     if (network) { c.network(string_to_network(network)); }
     if (peer_network) { c.peer_network(string_to_network(peer_network)); }
     c.generate_nodes(size);
@@ -256,7 +1161,10 @@ PyObject* dts::python::run_process(PyObject* self, PyObject* args, PyObject* kwd
     sys::argstream cpp_args;
     auto ret = get_nodes_and_arguments(args, kwds, cpp_nodes, cpp_args);
     if (!ret) { return ret; }
-    python_application->run_process(std::move(cpp_nodes), std::move(cpp_args));
+    {
+        ::python::gil_release g;
+        python_application->run_process(std::move(cpp_nodes), std::move(cpp_args));
+    }
     Py_RETURN_NONE;
 }
 
@@ -267,29 +1175,81 @@ PyObject* dts::python::kill_node(PyObject* self, PyObject* args, PyObject* kwds)
         return nullptr;
     }
     auto nodes = object_to_cluster_node_bitmap(py_nodes);
-    python_application->kill_process(std::move(nodes), sys::signal(value));
+    {
+        ::python::gil_release g;
+        python_application->kill_process(std::move(nodes), sys::signal(value));
+    }
+    Py_RETURN_NONE;
+}
+
+PyObject* dts::python::restart_node(PyObject* self, PyObject* args, PyObject* kwds) {
+    PyObject* py_nodes = nullptr;
+    int signal = SIGKILL;
+    double delay = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|id",
+                                     const_cast<char**>(restart_node_keywords),
+                                     &py_nodes, &signal, &delay)) {
+        return nullptr;
+    }
+    if (delay < 0) {
+        PyErr_SetString(PyExc_ValueError, "bad delay");
+        return nullptr;
+    }
+    auto nodes = object_to_cluster_node_bitmap(py_nodes);
+    using duration = std::chrono::system_clock::duration;
+    {
+        ::python::gil_release g;
+        python_application->restart_node(
+            std::move(nodes), sys::signal(signal),
+            std::chrono::duration_cast<duration>(seconds_to_duration(delay)));
+    }
     Py_RETURN_NONE;
 }
 
 PyObject* dts::python::add_test(PyObject* self, PyObject* args, PyObject* kwds) {
     const char* description = nullptr;
     PyObject* py_test = nullptr;
-    if (!PyArg_ParseTuple(args, "sO", &description, &py_test)) {
+    PyObject* py_depends = nullptr;
+    PyObject* py_triggers = nullptr;
+    double timeout = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "sO|OOd", const_cast<char**>(add_test_keywords),
+                                     &description, &py_test, &py_depends, &py_triggers,
+                                     &timeout)) {
         return nullptr;
     }
+    dts::string_array depends;
+    if (py_depends && py_depends != Py_None) { depends = object_to_string_array(py_depends); }
+    dts::string_array triggers;
+    if (py_triggers && py_triggers != Py_None) { triggers = object_to_string_array(py_triggers); }
+    ::python::object inspect = PyImport_ImportModule("inspect");
+    if (!inspect) { return nullptr; }
+    ::python::object is_coroutine =
+        PyObject_CallMethod(inspect.get(), "iscoroutinefunction", "O", py_test);
+    if (!is_coroutine) { return nullptr; }
     ::python::object py_test_copy(py_test);
     py_test_copy.retain();
-    python_application->emplace_test(
-        description, [py_test_copy] (dts::application&, const dts::string_array& lines) mutable {
-            const int n = lines.size();
-            PyObject* py_lines = PyList_New(n);
-            for (int i=0; i<n; ++i) {
-                PyList_SetItem(py_lines, i, PyUnicode_FromString(lines[i].data()));
-            }
-            PyObject_CallFunctionObjArgs(py_test_copy.get(),
-                                         py_lines,
-                                         nullptr);
-        });
+    if (PyObject_IsTrue(is_coroutine.get())) {
+        std::shared_ptr<coroutine_test> coroutine(new coroutine_test);
+        coroutine->function = std::move(py_test_copy);
+        python_application->emplace_test(
+            description, [coroutine] (dts::application&, const dts::line_array&) {
+                (*coroutine)();
+            }, std::move(depends));
+        python_application->last_test().trigger_flag(coroutine->trigger);
+    } else {
+        python_application->emplace_test(
+            description, [py_test_copy] (dts::application&, const dts::line_array& lines) mutable {
+                // tests may be evaluated concurrently in different threads
+                ::python::gil_guard g;
+                line_view_guard py_lines(lines);
+                ::python::object result =
+                    PyObject_CallFunctionObjArgs(py_test_copy.get(), py_lines.get(), nullptr);
+                if (!result) { throw_python_error(); }
+            }, std::move(depends));
+    }
+    auto& test = python_application->last_test();
+    test.triggers(std::move(triggers));
+    test.timeout(seconds_to_duration(timeout));
     Py_RETURN_NONE;
 }
 
@@ -318,8 +1278,143 @@ PyObject* dts::python::execution_delay(PyObject* self, PyObject* args, PyObject*
     Py_RETURN_NONE;
 }
 
+PyObject* dts::python::metrics(PyObject* self, PyObject* args, PyObject* kwds) {
+    int value = 0;
+    if (!PyArg_ParseTuple(args, "p", &value)) { return nullptr; }
+    python_application->print_metrics(bool(value));
+    Py_RETURN_NONE;
+}
+
+PyObject* dts::python::stats_file(PyObject* self, PyObject* args, PyObject* kwds) {
+    const char* filename = nullptr;
+    if (!PyArg_ParseTuple(args, "s", &filename)) { return nullptr; }
+    python_application->stats_file(filename);
+    Py_RETURN_NONE;
+}
+
+PyObject* dts::python::retention(PyObject* self, PyObject* args, PyObject* kwds) {
+    unsigned long max_memory = 0;
+    const char* filter = nullptr;
+    if (!PyArg_ParseTupleAndKeywords(
+        args, kwds, "|ks", const_cast<char**>(retention_keywords),
+        &max_memory, &filter)) {
+        return nullptr;
+    }
+    python_application->max_line_memory(max_memory*1024UL*1024UL);
+    if (filter) { python_application->retain_lines(filter); }
+    Py_RETURN_NONE;
+}
+
+PyObject* dts::python::buffers(PyObject* self, PyObject* args, PyObject* kwds) {
+    unsigned long max_line_length = python_application->max_line_length();
+    int pipe_size = python_application->pipe_size();
+    if (!PyArg_ParseTupleAndKeywords(
+        args, kwds, "|ki", const_cast<char**>(buffers_keywords),
+        &max_line_length, &pipe_size)) {
+        return nullptr;
+    }
+    if (max_line_length == 0 || pipe_size < 0) {
+        PyErr_SetString(PyExc_ValueError, "bad buffer size");
+        return nullptr;
+    }
+    python_application->max_line_length(max_line_length);
+    python_application->pipe_size(pipe_size);
+    Py_RETURN_NONE;
+}
+
+PyObject* dts::python::timeout(PyObject* self, PyObject* args, PyObject* kwds) {
+    double seconds = 0;
+    if (!PyArg_ParseTuple(args, "d", &seconds)) { return nullptr; }
+    if (seconds < 0) {
+        PyErr_SetString(PyExc_ValueError, "bad timeout");
+        return nullptr;
+    }
+    python_application->timeout(seconds_to_duration(seconds));
+    Py_RETURN_NONE;
+}
+
+PyObject* dts::python::test_threads(PyObject* self, PyObject* args, PyObject* kwds) {
+    unsigned long n = 0;
+    if (!PyArg_ParseTuple(args, "k", &n)) { return nullptr; }
+    python_application->num_test_threads(n);
+    Py_RETURN_NONE;
+}
+
+PyObject* dts::python::readers(PyObject* self, PyObject* args, PyObject* kwds) {
+    unsigned long n = 0;
+    if (!PyArg_ParseTuple(args, "k", &n)) { return nullptr; }
+    if (n == 0) {
+        PyErr_SetString(PyExc_ValueError, "bad number of readers");
+        return nullptr;
+    }
+    python_application->num_readers(n);
+    Py_RETURN_NONE;
+}
+
+PyObject* dts::python::zero_copy(PyObject* self, PyObject* args, PyObject* kwds) {
+    int value = 0;
+    if (!PyArg_ParseTuple(args, "p", &value)) { return nullptr; }
+    python_application->zero_copy(bool(value));
+    Py_RETURN_NONE;
+}
+
+PyObject* dts::python::event_ring(PyObject* self, PyObject* args, PyObject* kwds) {
+    unsigned long long size = 0;
+    unsigned long long watermark = 0;
+    if (!PyArg_ParseTupleAndKeywords(
+        args, kwds, "K|K", const_cast<char**>(event_ring_keywords), &size, &watermark)) {
+        return nullptr;
+    }
+    python_application->event_ring_size(size*1024UL);
+    python_application->event_ring_watermark(watermark);
+    Py_RETURN_NONE;
+}
+
+PyObject* dts::python::tmpfs(PyObject* self, PyObject* args, PyObject* kwds) {
+    const char* path = nullptr;
+    unsigned long long size = 0;
+    if (!PyArg_ParseTupleAndKeywords(
+        args, kwds, "s|K", const_cast<char**>(tmpfs_keywords), &path, &size)) {
+        return nullptr;
+    }
+    python_application->tmpfs_path(path);
+    python_application->tmpfs_size(size*1024UL*1024UL);
+    Py_RETURN_NONE;
+}
+
 PyObject* dts::python::run(PyObject* self, PyObject* args, PyObject* kwds) {
-    python_exit_code = dts::run(*python_application);
+    {
+        // the tests lock the GIL in output and test threads
+        ::python::gil_release g;
+        python_exit_code = dts::run(*python_application);
+    }
+    return PyLong_FromLong(python_exit_code);
+}
+
+PyObject* dts::python::record(PyObject* self, PyObject* args, PyObject* kwds) {
+    const char* filename = nullptr;
+    if (!PyArg_ParseTuple(args, "s", &filename)) { return nullptr; }
+    python_application->record_file(filename);
+    Py_RETURN_NONE;
+}
+
+PyObject* dts::python::replay(PyObject* self, PyObject* args, PyObject* kwds) {
+    const char* filename = nullptr;
+    if (!PyArg_ParseTuple(args, "s", &filename)) { return nullptr; }
+    python_application->replay_file(filename);
+    std::string error;
+    {
+        ::python::gil_release g;
+        try {
+            python_exit_code = dts::run(*python_application);
+        } catch (const std::exception& err) {
+            error = err.what();
+        }
+    }
+    if (!error.empty()) {
+        PyErr_SetString(PyExc_ValueError, error.data());
+        return nullptr;
+    }
     return PyLong_FromLong(python_exit_code);
 }
 
@@ -346,7 +1441,342 @@ PyObject* dts::python::expect_event_sequence(PyObject* self, PyObject* args, PyO
     PyObject* py_lines = nullptr;
     PyObject* py_events = nullptr;
     if (!PyArg_ParseTuple(args, "OO", &py_lines, &py_events)) { return nullptr; }
-    dts::expect_event_sequence(object_to_string_array(py_lines),
-                               object_to_string_array(py_events));
+    auto regex_strings = object_to_string_array(py_events);
+    if (PyObject_TypeCheck(py_lines, line_view_type)) {
+        // fast path: match captured lines in place
+        auto lines = get_lines(py_lines);
+        if (!lines) { return nullptr; }
+        ::python::gil_release g;
+        dts::expect_event_sequence(*lines, regex_strings);
+    } else {
+        dts::expect_event_sequence(object_to_string_array(py_lines), regex_strings);
+    }
+    Py_RETURN_NONE;
+}
+
+PyObject* dts::python::expect_event_count(PyObject* self, PyObject* args, PyObject* kwds) {
+    PyObject* py_lines = nullptr;
+    const char* regex = nullptr;
+    unsigned long long count = 0;
+    if (!PyArg_ParseTupleAndKeywords(
+        args, kwds, "OsK", const_cast<char**>(expect_event_count_keywords),
+        &py_lines, &regex, &count)) {
+        return nullptr;
+    }
+    if (PyObject_TypeCheck(py_lines, line_view_type)) {
+        auto lines = get_lines(py_lines);
+        if (!lines) { return nullptr; }
+        ::python::gil_release g;
+        dts::expect_event_count(*lines, regex, count);
+    } else {
+        dts::expect_event_count(object_to_string_array(py_lines), regex, count);
+    }
+    Py_RETURN_NONE;
+}
+
+PyObject* dts::python::events(PyObject* self, PyObject*) {
+    dts::event_array events;
+    {
+        // the output thread locks the GIL while the application mutex is locked
+        ::python::gil_release g;
+        events = python_application->copy_events();
+    }
+    const auto n = events.size();
+    ::python::object result = PyList_New(n);
+    if (!result) { return nullptr; }
+    using seconds = std::chrono::duration<double>;
+    for (size_t i=0; i<n; ++i) {
+        const auto& e = events[i];
+        const auto t = std::chrono::duration_cast<seconds>(e.timestamp.time_since_epoch());
+        PyObject* item = Py_BuildValue("(dIIy#)", t.count(), e.node, e.id,
+                                       e.payload.data(), Py_ssize_t(e.payload.size()));
+        if (!item) { return nullptr; }
+        PyList_SET_ITEM(result.get(), i, item);
+    }
+    result.retain();
+    return result.get();
+}
+
+PyObject* dts::python::expect_events(PyObject* self, PyObject* args) {
+    PyObject* py_events = nullptr;
+    if (!PyArg_ParseTuple(args, "O", &py_events)) { return nullptr; }
+    ::python::object py_sequence = PySequence_Fast(py_events, "expected a sequence");
+    if (!py_sequence) { return nullptr; }
+    const auto n = PySequence_Fast_GET_SIZE(py_sequence.get());
+    dts::event_pattern_array patterns;
+    patterns.reserve(n);
+    for (Py_ssize_t i=0; i<n; ++i) {
+        dts::event_pattern pattern(0);
+        if (!object_to_event_pattern(PySequence_Fast_GET_ITEM(py_sequence.get(), i), pattern)) {
+            return nullptr;
+        }
+        patterns.emplace_back(pattern);
+    }
+    ::python::gil_release g;
+    dts::expect_event_sequence(python_application->copy_events(), patterns);
+    Py_RETURN_NONE;
+}
+
+PyObject* dts::python::expect_event_id_count(PyObject* self, PyObject* args, PyObject* kwds) {
+    unsigned long id = 0;
+    unsigned long long count = 0;
+    long long node = dts::event_pattern::any_node;
+    if (!PyArg_ParseTupleAndKeywords(
+        args, kwds, "kK|L", const_cast<char**>(expect_event_id_count_keywords),
+        &id, &count, &node)) {
+        return nullptr;
+    }
+    ::python::gil_release g;
+    dts::expect_event_count(python_application->copy_events(),
+                            dts::event_pattern(id, node), count);
     Py_RETURN_NONE;
 }
+
+PyObject* dts::python::expect_latency(PyObject* self, PyObject* args, PyObject* kwds) {
+    PyObject* py_lines = nullptr;
+    const char* start = nullptr;
+    const char* end = nullptr;
+    double max = 0;
+    if (!PyArg_ParseTupleAndKeywords(
+        args, kwds, "Ossd", const_cast<char**>(expect_latency_keywords),
+        &py_lines, &start, &end, &max)) {
+        return nullptr;
+    }
+    auto lines = object_to_line_array(py_lines);
+    if (!lines) { return nullptr; }
+    {
+        ::python::gil_release g;
+        dts::expect_latency(*lines, start, end, milliseconds_to_latency(max));
+    }
+    Py_RETURN_NONE;
+}
+
+PyObject* dts::python::expect_latency_percentiles(PyObject* self, PyObject* args, PyObject* kwds) {
+    PyObject* py_lines = nullptr;
+    const char* start = nullptr;
+    const char* end = nullptr;
+    PyObject* p50 = nullptr;
+    PyObject* p99 = nullptr;
+    PyObject* max = nullptr;
+    if (!PyArg_ParseTupleAndKeywords(
+        args, kwds, "Oss|OOO", const_cast<char**>(expect_latency_percentiles_keywords),
+        &py_lines, &start, &end, &p50, &p99, &max)) {
+        return nullptr;
+    }
+    auto lines = object_to_line_array(py_lines);
+    if (!lines) { return nullptr; }
+    dts::latency_bounds bounds;
+    std::pair<PyObject*,dts::latency_type*> values[] = {
+        {p50, &bounds.p50}, {p99, &bounds.p99}, {max, &bounds.max}
+    };
+    for (auto& pair : values) {
+        if (!pair.first || pair.first == Py_None) { continue; }
+        const double ms = PyFloat_AsDouble(pair.first);
+        if (ms == -1 && PyErr_Occurred()) { return nullptr; }
+        *pair.second = milliseconds_to_latency(ms);
+    }
+    {
+        ::python::gil_release g;
+        dts::expect_latency_percentiles(*lines, start, end, bounds);
+    }
+    Py_RETURN_NONE;
+}
+
+PyObject* dts::python::extract(PyObject* self, PyObject* args, PyObject* kwds) {
+    const char* regex = nullptr;
+    PyObject* py_fields = nullptr;
+    PyObject* py_node = nullptr;
+    if (!PyArg_ParseTupleAndKeywords(
+        args, kwds, "s|OO", const_cast<char**>(extract_keywords), &regex, &py_fields, &py_node)) {
+        return nullptr;
+    }
+    size_t node = 0;
+    if (!object_to_node(py_node, node)) { return nullptr; }
+    dts::field_array fields;
+    if (!py_fields || py_fields == Py_None) {
+        const auto num_groups = std::regex(regex).mark_count();
+        for (size_t i=0; i<num_groups; ++i) {
+            fields.emplace_back(std::to_string(i+1), dts::field::types::real);
+        }
+    } else {
+        ::python::object py_sequence = PySequence_Fast(py_fields, "expected a sequence");
+        if (!py_sequence) { return nullptr; }
+        const auto n = PySequence_Fast_GET_SIZE(py_sequence.get());
+        fields.resize(n);
+        for (Py_ssize_t i=0; i<n; ++i) {
+            if (!object_to_field(PySequence_Fast_GET_ITEM(py_sequence.get(), i), fields[i])) {
+                return nullptr;
+            }
+            if (fields[i].name == "node" || fields[i].name == "timestamp") {
+                PyErr_SetString(PyExc_ValueError, "reserved field name");
+                return nullptr;
+            }
+        }
+    }
+    dts::extracted_columns columns;
+    {
+        // the application mutex is locked after the GIL is released
+        ::python::gil_release g;
+        columns = python_application->extract(regex, fields, node);
+    }
+    ::python::object result = PyDict_New();
+    if (!result) { return nullptr; }
+    if (!add_column(result.get(), "node", column_to_memoryview(columns.nodes, "i")) ||
+        !add_column(result.get(), "timestamp", column_to_memoryview(columns.timestamps, "d"))) {
+        return nullptr;
+    }
+    const auto num_fields = fields.size();
+    for (size_t i=0; i<num_fields; ++i) {
+        const auto& f = fields[i];
+        const auto j = columns.columns[i];
+        auto column = f.type == dts::field::types::integer
+            ? column_to_memoryview(columns.integers[j], "q")
+            : column_to_memoryview(columns.reals[j], "d");
+        if (!add_column(result.get(), f.name.data(), column)) { return nullptr; }
+    }
+    result.retain();
+    return result.get();
+}
+
+PyObject* dts::python::event(PyObject* self, PyObject* args, PyObject* kwds) {
+    const char* regex = nullptr;
+    PyObject* node = nullptr;
+    PyObject* timeout = nullptr;
+    if (!PyArg_ParseTupleAndKeywords(
+        args, kwds, "s|OO", const_cast<char**>(event_keywords), &regex, &node, &timeout)) {
+        return nullptr;
+    }
+    return wait_for_lines({regex}, node, timeout, false);
+}
+
+PyObject* dts::python::sequence(PyObject* self, PyObject* args, PyObject* kwds) {
+    PyObject* regexes = nullptr;
+    PyObject* node = nullptr;
+    PyObject* timeout = nullptr;
+    if (!PyArg_ParseTupleAndKeywords(
+        args, kwds, "O|OO", const_cast<char**>(sequence_keywords), &regexes, &node, &timeout)) {
+        return nullptr;
+    }
+    return wait_for_lines(object_to_string_array(regexes), node, timeout, true);
+}
+
+PyObject* dts::python::exited(PyObject* self, PyObject* args, PyObject* kwds) {
+    PyObject* py_nodes = nullptr;
+    PyObject* timeout = nullptr;
+    if (!PyArg_ParseTupleAndKeywords(
+        args, kwds, "O|O", const_cast<char**>(exited_keywords), &py_nodes, &timeout)) {
+        return nullptr;
+    }
+    dts::cluster_node_bitmap nodes;
+    if (PyLong_Check(py_nodes)) {
+        const auto node = PyLong_AsSize_t(py_nodes);
+        if (PyErr_Occurred()) { return nullptr; }
+        nodes = dts::cluster_node_bitmap(python_application->cluster().size(), {node});
+    } else {
+        nodes = object_to_cluster_node_bitmap(py_nodes);
+    }
+    auto f = make_future();
+    if (!f) { return nullptr; }
+    auto callback = [f] (const dts::process_waiter::status_array& statuses) {
+        ::python::gil_guard g;
+        const auto n = statuses.size();
+        ::python::object value = PyList_New(n);
+        if (!value) { PyErr_Clear(); return; }
+        for (size_t i=0; i<n; ++i) {
+            PyObject* item = nullptr;
+            if (statuses[i] == dts::process_waiter::unknown_status) {
+                Py_INCREF(Py_None);
+                item = Py_None;
+            } else {
+                item = PyLong_FromLong(statuses[i]);
+            }
+            PyList_SET_ITEM(value.get(), i, item);
+        }
+        f->resolve(value.get());
+    };
+    size_t id = 0;
+    std::string error;
+    {
+        ::python::gil_release g;
+        try {
+            id = python_application->wait_for_exit(std::move(nodes), std::move(callback));
+        } catch (const std::exception& err) {
+            error = err.what();
+        }
+    }
+    if (!error.empty()) {
+        PyErr_SetString(PyExc_RuntimeError, error.data());
+        return nullptr;
+    }
+    return await_future(*f, id, timeout);
+}
+
+PyObject* dts::python::perf_counters(PyObject* self, PyObject* args, PyObject* kwds) {
+    int value = 0;
+    if (!PyArg_ParseTuple(args, "p", &value)) { return nullptr; }
+    python_application->perf_counters(bool(value));
+    Py_RETURN_NONE;
+}
+
+PyObject* dts::python::counters(PyObject* self, PyObject* args, PyObject* kwds) {
+    PyObject* py_node = nullptr;
+    PyObject* py_process = nullptr;
+    if (!PyArg_ParseTupleAndKeywords(
+        args, kwds, "|OO", const_cast<char**>(counters_keywords), &py_node, &py_process)) {
+        return nullptr;
+    }
+    size_t node = 0, process = 0;
+    if (!object_to_node(py_node, node) || !object_to_process(py_process, process)) {
+        return nullptr;
+    }
+    dts::perf_values values;
+    {
+        // the application mutex is locked after the GIL is released
+        ::python::gil_release g;
+        values = python_application->counters(node, process);
+    }
+    ::python::object result = PyDict_New();
+    if (!result) { return nullptr; }
+    for (size_t i=0; i<dts::num_perf_counters; ++i) {
+        const auto c = dts::perf_counter(i);
+        if (!values.has(c)) { continue; }
+        ::python::object value = PyLong_FromUnsignedLongLong(values[c]);
+        if (!value || PyDict_SetItemString(result.get(), dts::to_string(c), value.get()) != 0) {
+            return nullptr;
+        }
+    }
+    result.retain();
+    return result.get();
+}
+
+PyObject* dts::python::capture(PyObject* self, PyObject* args, PyObject* kwds) {
+    const char* filename = nullptr;
+    if (!PyArg_ParseTupleAndKeywords(
+        args, kwds, "|z", const_cast<char**>(capture_keywords), &filename)) {
+        return nullptr;
+    }
+    python_application->capture_traffic(true);
+    python_application->capture_file(filename ? filename : "");
+    Py_RETURN_NONE;
+}
+
+PyObject* dts::python::traffic(PyObject* self, PyObject* args, PyObject* kwds) {
+    PyObject* py_node = nullptr;
+    if (!PyArg_ParseTupleAndKeywords(
+        args, kwds, "|O", const_cast<char**>(traffic_keywords), &py_node)) {
+        return nullptr;
+    }
+    size_t node = 0;
+    if (!object_to_node(py_node, node)) { return nullptr; }
+    dts::traffic_summary summary;
+    {
+        // the application mutex is locked after the GIL is released
+        ::python::gil_release g;
+        summary = python_application->traffic(node);
+    }
+    return Py_BuildValue("{sKsKsKsK}",
+                         "packets_sent", (unsigned long long)summary.packets_sent,
+                         "bytes_sent", (unsigned long long)summary.bytes_sent,
+                         "packets_received", (unsigned long long)summary.packets_received,
+                         "bytes_received", (unsigned long long)summary.bytes_received);
+}
@@ -31,6 +31,19 @@ namespace python {
         gil_guard& operator=(gil_guard&&) = delete;
     };
 
+    /// Releases the GIL in the current thread (e.g. before locking application mutex).
+    class gil_release {
+    private:
+        ::PyThreadState* _state;
+    public:
+        inline gil_release() noexcept: _state(::PyEval_SaveThread()) {}
+        inline ~gil_release() noexcept { ::PyEval_RestoreThread(this->_state); }
+        gil_release(const gil_release&) = delete;
+        gil_release& operator=(const gil_release&) = delete;
+        gil_release(gil_release&&) = delete;
+        gil_release& operator=(gil_release&&) = delete;
+    };
+
     struct python_pointer_deleter {
         inline void operator()(void* ptr) { ::PyMem_RawFree(ptr); }
     };
@@ -87,13 +100,40 @@ namespace dts {
         PyObject* add_process(PyObject* self, PyObject* args, PyObject* kwds);
         PyObject* run_process(PyObject* self, PyObject* args, PyObject* kwds);
         PyObject* kill_node(PyObject* self, PyObject* args, PyObject* kwds);
+        PyObject* restart_node(PyObject* self, PyObject* args, PyObject* kwds);
         PyObject* add_test(PyObject* self, PyObject* args, PyObject* kwds);
         PyObject* will_restart(PyObject* self, PyObject* args, PyObject* kwds);
         PyObject* user_namespaces(PyObject* self, PyObject* args, PyObject* kwds);
         PyObject* execution_delay(PyObject* self, PyObject* args, PyObject* kwds);
+        PyObject* metrics(PyObject* self, PyObject* args, PyObject* kwds);
+        PyObject* stats_file(PyObject* self, PyObject* args, PyObject* kwds);
+        PyObject* retention(PyObject* self, PyObject* args, PyObject* kwds);
+        PyObject* buffers(PyObject* self, PyObject* args, PyObject* kwds);
+        PyObject* timeout(PyObject* self, PyObject* args, PyObject* kwds);
+        PyObject* test_threads(PyObject* self, PyObject* args, PyObject* kwds);
+        PyObject* readers(PyObject* self, PyObject* args, PyObject* kwds);
+        PyObject* zero_copy(PyObject* self, PyObject* args, PyObject* kwds);
+        PyObject* event_ring(PyObject* self, PyObject* args, PyObject* kwds);
+        PyObject* tmpfs(PyObject* self, PyObject* args, PyObject* kwds);
         PyObject* run(PyObject* self, PyObject* args, PyObject* kwds);
+        PyObject* record(PyObject* self, PyObject* args, PyObject* kwds);
+        PyObject* replay(PyObject* self, PyObject* args, PyObject* kwds);
         PyObject* fail(PyObject* self, PyObject* args, PyObject* kwds);
         PyObject* expect_event_sequence(PyObject* self, PyObject* args, PyObject* kwds);
+        PyObject* expect_event_count(PyObject* self, PyObject* args, PyObject* kwds);
+        PyObject* events(PyObject* self, PyObject*);
+        PyObject* expect_events(PyObject* self, PyObject* args);
+        PyObject* expect_event_id_count(PyObject* self, PyObject* args, PyObject* kwds);
+        PyObject* expect_latency(PyObject* self, PyObject* args, PyObject* kwds);
+        PyObject* expect_latency_percentiles(PyObject* self, PyObject* args, PyObject* kwds);
+        PyObject* extract(PyObject* self, PyObject* args, PyObject* kwds);
+        PyObject* perf_counters(PyObject* self, PyObject* args, PyObject* kwds);
+        PyObject* counters(PyObject* self, PyObject* args, PyObject* kwds);
+        PyObject* capture(PyObject* self, PyObject* args, PyObject* kwds);
+        PyObject* traffic(PyObject* self, PyObject* args, PyObject* kwds);
+        PyObject* event(PyObject* self, PyObject* args, PyObject* kwds);
+        PyObject* sequence(PyObject* self, PyObject* args, PyObject* kwds);
+        PyObject* exited(PyObject* self, PyObject* args, PyObject* kwds);
     }
 }
 
@@ -0,0 +1,224 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#include <dtest/config.hh>
+#include <dtest/recording.hh>
+
+#if defined(DTEST_HAVE_ZLIB)
+#include <zlib.h>
+#endif
+
+namespace {
+
+    constexpr const char magic[8] = {'D','T','E','S','T','R','E','C'};
+    constexpr std::uint32_t version = 1;
+    constexpr size_t alignment = 8;
+
+    inline size_t padding(size_t size) {
+        return (alignment - size%alignment) % alignment;
+    }
+
+    inline bool is_compressed(const std::string& filename) {
+        const std::string suffix = ".gz";
+        return filename.size() > suffix.size() &&
+            filename.compare(filename.size()-suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    inline void throw_no_zlib() {
+        throw std::invalid_argument("dtest is built without zlib, compressed recordings are not supported");
+    }
+
+}
+
+dts::recording_writer::recording_writer(const std::string& filename):
+_compressed(is_compressed(filename)) {
+    if (this->_compressed) {
+        #if defined(DTEST_HAVE_ZLIB)
+        this->_file = ::gzopen(filename.data(), "wb");
+        #else
+        throw_no_zlib();
+        #endif
+    } else {
+        this->_file = std::fopen(filename.data(), "wb");
+    }
+    if (!this->_file) { throw std::system_error(errno, std::generic_category()); }
+    std::uint32_t header[2] = {version, 0};
+    write(magic, sizeof(magic));
+    write(header, sizeof(header));
+}
+
+dts::recording_writer::~recording_writer() { close(); }
+
+dts::recording_writer::recording_writer(recording_writer&& rhs) noexcept:
+_file(rhs._file), _compressed(rhs._compressed) {
+    rhs._file = nullptr;
+}
+
+auto dts::recording_writer::operator=(recording_writer&& rhs) noexcept -> recording_writer& {
+    std::swap(this->_file, rhs._file);
+    std::swap(this->_compressed, rhs._compressed);
+    return *this;
+}
+
+void dts::recording_writer::close() {
+    if (!this->_file) { return; }
+    #if defined(DTEST_HAVE_ZLIB)
+    if (this->_compressed) { ::gzclose(static_cast<::gzFile>(this->_file)); }
+    #endif
+    if (!this->_compressed) { std::fclose(static_cast<std::FILE*>(this->_file)); }
+    this->_file = nullptr;
+}
+
+void dts::recording_writer::flush() {
+    if (!this->_file) { return; }
+    #if defined(DTEST_HAVE_ZLIB)
+    if (this->_compressed) { ::gzflush(static_cast<::gzFile>(this->_file), Z_SYNC_FLUSH); }
+    #endif
+    if (!this->_compressed) { std::fflush(static_cast<std::FILE*>(this->_file)); }
+}
+
+void dts::recording_writer::write(const void* data, size_t size) {
+    #if defined(DTEST_HAVE_ZLIB)
+    if (this->_compressed) {
+        if (::gzwrite(static_cast<::gzFile>(this->_file), data, size) != int(size)) {
+            throw std::runtime_error("failed to write the recording");
+        }
+        return;
+    }
+    #endif
+    if (std::fwrite(data, 1, size, static_cast<std::FILE*>(this->_file)) != size) {
+        throw std::system_error(errno, std::generic_category());
+    }
+}
+
+void dts::recording_writer::write(const record_header& header, const char* data) {
+    constexpr const char zeroes[alignment] = {};
+    write(&header, sizeof(header));
+    write(data, header.size);
+    write(zeroes, padding(header.size));
+}
+
+void dts::recording_writer::write_stream(std::uint32_t stream, std::uint64_t node,
+                                         const std::string& prefix) {
+    record_header header;
+    header.type = record_header::stream_record;
+    header.stream = stream;
+    header.value = node;
+    header.size = prefix.size();
+    write(header, prefix.data());
+}
+
+void dts::recording_writer::write_line(const line_info& info, const char* data, size_t size) {
+    using namespace std::chrono;
+    record_header header;
+    header.type = record_header::line_record;
+    header.stream = info.stream;
+    header.value = duration_cast<nanoseconds>(info.timestamp.time_since_epoch()).count();
+    header.size = size;
+    write(header, data);
+}
+
+dts::recording_reader::recording_reader(const std::string& filename) {
+    if (is_compressed(filename)) {
+        #if defined(DTEST_HAVE_ZLIB)
+        auto file = ::gzopen(filename.data(), "rb");
+        if (!file) { throw std::system_error(errno, std::generic_category()); }
+        char chunk[4096*16];
+        int n = 0;
+        while ((n = ::gzread(file, chunk, sizeof(chunk))) > 0) {
+            this->_buffer.insert(this->_buffer.end(), chunk, chunk+n);
+        }
+        ::gzclose(file);
+        if (n < 0) { throw std::runtime_error("failed to read the recording"); }
+        this->_data = this->_buffer.data();
+        this->_size = this->_buffer.size();
+        #else
+        throw_no_zlib();
+        #endif
+    } else {
+        int fd = ::open(filename.data(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1) { throw std::system_error(errno, std::generic_category()); }
+        struct ::stat status{};
+        if (::fstat(fd, &status) == -1) {
+            int error = errno;
+            ::close(fd);
+            throw std::system_error(error, std::generic_category());
+        }
+        this->_size = status.st_size;
+        if (this->_size != 0) {
+            void* ptr = ::mmap(nullptr, this->_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (ptr == MAP_FAILED) {
+                int error = errno;
+                ::close(fd);
+                throw std::system_error(error, std::generic_category());
+            }
+            ::madvise(ptr, this->_size, MADV_SEQUENTIAL);
+            this->_data = static_cast<const char*>(ptr);
+        }
+        ::close(fd);
+    }
+    // the destructor is not called when the constructor throws
+    if (this->_size < sizeof(magic) + 2*sizeof(std::uint32_t) ||
+        std::memcmp(this->_data, magic, sizeof(magic)) != 0) {
+        unmap();
+        throw std::invalid_argument("bad recording");
+    }
+    std::uint32_t file_version = 0;
+    std::memcpy(&file_version, this->_data+sizeof(magic), sizeof(file_version));
+    if (file_version != version) {
+        unmap();
+        throw std::invalid_argument("unsupported recording version " +
+                                    std::to_string(file_version));
+    }
+}
+
+dts::recording_reader::~recording_reader() { unmap(); }
+
+void dts::recording_reader::unmap() {
+    if (this->_data && this->_buffer.empty()) {
+        ::munmap(const_cast<char*>(this->_data), this->_size);
+    }
+    this->_data = nullptr;
+    this->_size = 0;
+}
+
+void dts::recording_reader::read(line_array& lines) {
+    std::vector<line_info::sequence_type> sequences;
+    size_t offset = sizeof(magic) + 2*sizeof(std::uint32_t);
+    while (offset + sizeof(record_header) <= this->_size) {
+        record_header header;
+        std::memcpy(&header, this->_data+offset, sizeof(header));
+        offset += sizeof(header);
+        if (offset + header.size > this->_size) {
+            throw std::invalid_argument("truncated recording");
+        }
+        const char* payload = this->_data+offset;
+        offset += header.size + padding(header.size);
+        if (header.stream >= this->_streams.size()) {
+            this->_streams.resize(header.stream+1);
+            sequences.resize(header.stream+1);
+        }
+        auto& stream = this->_streams[header.stream];
+        if (header.type == record_header::stream_record) {
+            stream.node = header.value;
+            stream.prefix.assign(payload, header.size);
+            lines.prefix(header.stream, stream.prefix);
+        } else if (header.type == record_header::line_record) {
+            line_info info;
+            using namespace std::chrono;
+            info.timestamp = line_info::time_point(
+                duration_cast<line_info::clock_type::duration>(nanoseconds(header.value)));
+            info.stream = header.stream;
+            info.sequence = sequences[header.stream]++;
+            lines.emplace_back(std::string(payload, header.size), info);
+        }
+    }
+}
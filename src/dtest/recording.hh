@@ -0,0 +1,93 @@
+#ifndef DTEST_RECORDING_HH
+#define DTEST_RECORDING_HH
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <dtest/line_array.hh>
+
+namespace dts {
+
+    /**
+    \brief Binary recording of the captured output.
+    \details The file starts with 16-byte header (magic and version) that
+    is followed by the records. Each record consists of fixed-size header and
+    the payload padded to 8 bytes, so that uncompressed file can be
+    memory-mapped and read in place. Stream records map stream index to
+    node index and line prefix, line records contain the line without the prefix.
+    Files with ".gz" suffix are compressed with zlib (when dtest is built with zlib).
+    */
+    struct record_header {
+        enum types: std::uint32_t {stream_record=1, line_record=2};
+        std::uint32_t type = 0;
+        std::uint32_t stream = 0;
+        /// Nanoseconds since CLOCK_MONOTONIC epoch for lines, node index for streams.
+        std::uint64_t value = 0;
+        std::uint64_t size = 0;
+    };
+
+    class recording_writer {
+
+    private:
+        void* _file = nullptr;
+        bool _compressed = false;
+
+    public:
+        recording_writer() = default;
+        explicit recording_writer(const std::string& filename);
+        ~recording_writer();
+        recording_writer(const recording_writer&) = delete;
+        recording_writer& operator=(const recording_writer&) = delete;
+        recording_writer(recording_writer&& rhs) noexcept;
+        recording_writer& operator=(recording_writer&& rhs) noexcept;
+
+        void write_stream(std::uint32_t stream, std::uint64_t node, const std::string& prefix);
+        void write_line(const line_info& info, const char* data, size_t size);
+        void flush();
+        void close();
+
+        inline explicit operator bool() const noexcept { return this->_file != nullptr; }
+        inline bool operator!() const noexcept { return !this->operator bool(); }
+
+    private:
+        void write(const record_header& header, const char* data);
+        void write(const void* data, size_t size);
+
+    };
+
+    class recording_reader {
+
+    public:
+        struct stream_type {
+            std::uint64_t node = 0;
+            std::string prefix;
+        };
+        using stream_array = std::vector<stream_type>;
+
+    private:
+        const char* _data = nullptr;
+        size_t _size = 0;
+        std::vector<char> _buffer;
+        stream_array _streams;
+
+    public:
+        explicit recording_reader(const std::string& filename);
+        ~recording_reader();
+        recording_reader(const recording_reader&) = delete;
+        recording_reader& operator=(const recording_reader&) = delete;
+
+        /// Append all recorded lines to \p lines and set prefixes of their streams.
+        void read(line_array& lines);
+
+        inline const stream_array& streams() const noexcept { return this->_streams; }
+
+    private:
+        void unmap();
+
+    };
+
+}
+
+#endif // vim:filetype=cpp
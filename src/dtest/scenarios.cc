@@ -0,0 +1,363 @@
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+#include <dtest/scenarios.hh>
+
+namespace {
+
+    volatile std::sig_atomic_t stop_signal = 0;
+
+    void on_terminate(int sig) { stop_signal = sig; }
+
+    void bind_terminate_signals() {
+        struct ::sigaction action{};
+        action.sa_handler = on_terminate;
+        // no SA_RESTART: waitpid is interrupted to forward the signal
+        ::sigemptyset(&action.sa_mask);
+        for (int sig : {SIGINT, SIGTERM, SIGHUP, SIGQUIT}) {
+            if (::sigaction(sig, &action, nullptr) == -1) {
+                throw std::system_error(errno, std::generic_category());
+            }
+        }
+    }
+
+    /// Bijective base-26 numbering: a, b, ..., z, aa, ab, ...
+    /// The names contain letters only, hence they never clash with node names
+    /// that end with digits.
+    std::string cluster_name(size_t i) {
+        std::string name;
+        while (true) {
+            name.insert(name.begin(), char('a' + i%26));
+            if (i < 26) { break; }
+            i = i/26 - 1;
+        }
+        return name;
+    }
+
+    std::string subnetwork(std::uint32_t base, size_t i, unsigned prefix) {
+        std::uint32_t address = base + (std::uint32_t(i) << (32-prefix)) + 1;
+        std::stringstream tmp;
+        tmp << (address>>24) << '.' << ((address>>16)&255) << '.'
+            << ((address>>8)&255) << '.' << (address&255) << '/' << prefix;
+        return tmp.str();
+    }
+
+    std::string base_name(const std::string& path) {
+        auto pos = path.rfind('/');
+        return pos == std::string::npos ? path : path.substr(pos+1);
+    }
+
+    std::string executable_directory() {
+        std::string path(4096, '\0');
+        auto n = ::readlink("/proc/self/exe", &path[0], path.size());
+        if (n == -1) { return std::string(); }
+        path.resize(n);
+        auto pos = path.rfind('/');
+        return pos == std::string::npos ? std::string() : path.substr(0, pos+1);
+    }
+
+    /// Prefer the executable that is installed in the same directory as dtest-scenarios.
+    std::string sibling_executable(const std::string& dir, const std::string& name) {
+        auto path = dir + name;
+        return (!dir.empty() && ::access(path.data(), X_OK) == 0) ? path : name;
+    }
+
+    /// Split the line into arguments like the shell does: the arguments are separated
+    /// by whitespace, single quotes preserve every character, double quotes preserve
+    /// every character except the backslash that escapes double quote and backslash,
+    /// and unquoted "#" starts the comment.
+    void split_arguments(const std::string& line, std::vector<std::string>& result) {
+        std::string arg;
+        bool has_arg = false;
+        const auto n = line.size();
+        for (size_t i=0; i<n; ++i) {
+            const char ch = line[i];
+            if (std::isspace(static_cast<unsigned char>(ch))) {
+                if (has_arg) { result.emplace_back(std::move(arg)); arg.clear(); }
+                has_arg = false;
+                continue;
+            }
+            if (ch == '#' && !has_arg) { break; }
+            has_arg = true;
+            if (ch == '\\' && i+1 != n) {
+                arg += line[++i];
+            } else if (ch == '\'') {
+                auto last = line.find('\'', i+1);
+                if (last == std::string::npos) { throw std::invalid_argument("unterminated quote"); }
+                arg.append(line, i+1, last-i-1);
+                i = last;
+            } else if (ch == '"') {
+                for (++i; i<n && line[i] != '"'; ++i) {
+                    if (line[i] == '\\' && i+1 != n && (line[i+1] == '"' || line[i+1] == '\\')) {
+                        ++i;
+                    }
+                    arg += line[i];
+                }
+                if (i == n) { throw std::invalid_argument("unterminated quote"); }
+            } else {
+                arg += ch;
+            }
+        }
+        if (has_arg) { result.emplace_back(std::move(arg)); }
+    }
+
+    std::vector<std::string> read_arguments(const std::string& path) {
+        std::ifstream in(path);
+        if (!in.is_open()) {
+            std::stringstream tmp;
+            tmp << "unable to open scenario " << path;
+            throw std::invalid_argument(tmp.str());
+        }
+        std::vector<std::string> result;
+        std::string line;
+        while (std::getline(in, line)) {
+            try {
+                split_arguments(line, result);
+            } catch (const std::invalid_argument& err) {
+                std::stringstream tmp;
+                tmp << path << ": " << err.what();
+                throw std::invalid_argument(tmp.str());
+            }
+        }
+        return result;
+    }
+
+    template <class T> inline T
+    read_number(int argc, char* argv[], int& i, const char* name) {
+        std::string message = "bad ";
+        message += name;
+        if (i+1 == argc) { throw std::invalid_argument(message); }
+        std::stringstream tmp(argv[++i]);
+        T value{};
+        tmp >> value;
+        if (!tmp) { throw std::invalid_argument(message); }
+        return value;
+    }
+
+}
+
+dts::scenario_runner::scenario_runner():
+_max_cpus(std::max(1u, std::thread::hardware_concurrency())) {}
+
+void dts::scenario_runner::usage() {
+    std::cout <<
+        "usage: dtest-scenarios [-h] [--help] [--cpus n] [--cpus-per-scenario n]\n"
+        "      [--memory n] [--memory-per-scenario n] [--prefix n] [--output directory]\n"
+        "      scenario...\n"
+        "--cpus n                 run scenarios that require at most n CPUs in total\n"
+        "                         (default is the number of online CPUs)\n"
+        "--cpus-per-scenario n    the number of CPUs each scenario requires (default is 1)\n"
+        "--memory n               run scenarios that require at most n megabytes\n"
+        "                         of memory in total (default is unlimited)\n"
+        "--memory-per-scenario n  megabytes of memory each scenario requires\n"
+        "--prefix n               network prefix length of each scenario\n"
+        "                         (default is 24, i.e. 10.1.0.0/24, 10.1.1.0/24, ...)\n"
+        "--output directory       directory for the output of the scenarios\n"
+        "                         (default is dtest-logs)\n"
+        "scenario                 Python script (.py) or a file with dtest arguments\n"
+        "                         (quoted as in the shell, \"#\" starts the comment)\n"
+        "\n"
+        "Each scenario is executed by dtest-python or dtest with unique default cluster\n"
+        "name and non-overlapping networks (DTEST_NAME, DTEST_NETWORK and\n"
+        "DTEST_PEER_NETWORK environment variables). The name and the networks\n"
+        "that are specified explicitly in the scenario take precedence.\n";
+}
+
+void dts::scenario_runner::init(int argc, char* argv[]) {
+    for (int i=1; i<argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            usage();
+            std::exit(0);
+        } else if (arg == "--cpus") {
+            this->_max_cpus = read_number<size_t>(argc, argv, i, "--cpus");
+            if (this->_max_cpus == 0) { throw std::invalid_argument("bad --cpus"); }
+        } else if (arg == "--cpus-per-scenario") {
+            this->_cpus_per_scenario = read_number<size_t>(argc, argv, i, "--cpus-per-scenario");
+        } else if (arg == "--memory") {
+            this->_max_memory = read_number<size_t>(argc, argv, i, "--memory");
+        } else if (arg == "--memory-per-scenario") {
+            this->_memory_per_scenario =
+                read_number<size_t>(argc, argv, i, "--memory-per-scenario");
+        } else if (arg == "--prefix") {
+            this->_prefix = read_number<unsigned>(argc, argv, i, "--prefix");
+            if (this->_prefix < 17 || this->_prefix > 30) {
+                throw std::invalid_argument("bad --prefix");
+            }
+        } else if (arg == "--output") {
+            if (i+1 == argc) { throw std::invalid_argument("bad --output"); }
+            this->_output_directory = argv[++i];
+        } else if (!arg.empty() && arg.front() == '-') {
+            std::stringstream tmp;
+            tmp << "unknown argument: " << arg;
+            throw std::invalid_argument(tmp.str());
+        } else {
+            this->_scenarios.emplace_back();
+            auto& s = this->_scenarios.back();
+            s.path = arg;
+            auto n = arg.size();
+            if (n > 3 && arg.compare(n-3, 3, ".py") == 0) {
+                s.kind = scenario::kind_type::python;
+            }
+        }
+    }
+    if (this->_scenarios.empty()) { throw std::invalid_argument("no scenarios"); }
+    const auto dir = executable_directory();
+    this->_dtest = sibling_executable(dir, "dtest");
+    this->_dtest_python = sibling_executable(dir, "dtest-python");
+    allocate();
+}
+
+void dts::scenario_runner::allocate() {
+    // the scenarios share 10.1.0.0/16 and 10.0.0.0/16 (the default networks)
+    const size_t max_scenarios = size_t(1) << (this->_prefix-16);
+    const auto num_scenarios = this->_scenarios.size();
+    if (num_scenarios > max_scenarios) {
+        std::stringstream tmp;
+        tmp << "at most " << max_scenarios << " scenarios are supported with --prefix "
+            << this->_prefix;
+        throw std::invalid_argument(tmp.str());
+    }
+    for (size_t i=0; i<num_scenarios; ++i) {
+        auto& s = this->_scenarios[i];
+        s.name = cluster_name(i);
+        s.network = subnetwork((10u<<24) | (1u<<16), i, this->_prefix);
+        s.peer_network = subnetwork(10u<<24, i, this->_prefix);
+        s.log_file = this->_output_directory + '/' + s.name + '-' + base_name(s.path) + ".log";
+    }
+}
+
+void dts::scenario_runner::launch(scenario& s) {
+    std::vector<std::string> args;
+    if (s.kind == scenario::kind_type::python) {
+        args.emplace_back(this->_dtest_python);
+        args.emplace_back(s.path);
+    } else {
+        args = read_arguments(s.path);
+        args.insert(args.begin(), this->_dtest);
+    }
+    std::vector<char*> argv;
+    for (auto& a : args) { argv.emplace_back(&a[0]); }
+    argv.emplace_back(nullptr);
+    s.start = scenario::clock_type::now();
+    auto pid = ::fork();
+    if (pid == -1) { throw std::system_error(errno, std::generic_category()); }
+    if (pid == 0) {
+        int fd = ::open(s.log_file.data(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd == -1 || ::dup2(fd, STDOUT_FILENO) == -1 || ::dup2(fd, STDERR_FILENO) == -1) {
+            ::_exit(127);
+        }
+        ::setenv("DTEST_NAME", s.name.data(), 1);
+        ::setenv("DTEST_NETWORK", s.network.data(), 1);
+        ::setenv("DTEST_PEER_NETWORK", s.peer_network.data(), 1);
+        ::execvp(argv.front(), argv.data());
+        ::_exit(127);
+    }
+    s.id = pid;
+    std::cout << "dtest-scenarios: " << s.name << ' ' << s.path << " started (pid "
+        << pid << ", network " << s.network << ")" << std::endl;
+}
+
+int dts::scenario_runner::run() {
+    if (::mkdir(this->_output_directory.data(), 0755) == -1 && errno != EEXIST) {
+        throw std::system_error(errno, std::generic_category());
+    }
+    struct ::stat st;
+    if (::stat(this->_output_directory.data(), &st) == -1 || !S_ISDIR(st.st_mode)) {
+        std::stringstream tmp;
+        tmp << this->_output_directory << " is not a directory";
+        throw std::invalid_argument(tmp.str());
+    }
+    bind_terminate_signals();
+    const auto num_scenarios = this->_scenarios.size();
+    size_t next = 0, num_running = 0, cpus = 0, memory = 0;
+    bool stopping = false;
+    auto fits = [&] () {
+        if (num_running == 0) { return true; }
+        if (cpus + this->_cpus_per_scenario > this->_max_cpus) { return false; }
+        return this->_max_memory == 0 ||
+            memory + this->_memory_per_scenario <= this->_max_memory;
+    };
+    while (next != num_scenarios || num_running != 0) {
+        while (!stopping && next != num_scenarios && fits()) {
+            launch(this->_scenarios[next++]);
+            ++num_running;
+            cpus += this->_cpus_per_scenario;
+            memory += this->_memory_per_scenario;
+        }
+        if (num_running == 0) { break; }
+        int status = 0;
+        auto pid = ::waitpid(-1, &status, 0);
+        if (pid == -1) {
+            if (errno != EINTR) { throw std::system_error(errno, std::generic_category()); }
+            if (stop_signal != 0 && !stopping) {
+                // dtest terminates its cluster when it receives the signal
+                stopping = true;
+                for (const auto& s : this->_scenarios) {
+                    if (s.id != 0 && !s.finished) { ::kill(s.id, SIGTERM); }
+                }
+            }
+            continue;
+        }
+        auto result = std::find_if(this->_scenarios.begin(), this->_scenarios.end(),
+                                   [pid] (const scenario& s) { return s.id == pid; });
+        if (result == this->_scenarios.end()) { continue; }
+        auto& s = *result;
+        s.status = status;
+        s.finished = true;
+        s.duration = scenario::clock_type::now() - s.start;
+        --num_running;
+        cpus -= this->_cpus_per_scenario;
+        memory -= this->_memory_per_scenario;
+        std::cout << "dtest-scenarios: " << s.name << ' ' << s.path
+            << (s.succeeded() ? " succeeded" : " failed") << std::endl;
+    }
+    report(std::cout);
+    bool success = std::all_of(this->_scenarios.begin(), this->_scenarios.end(),
+                               [] (const scenario& s) { return s.succeeded(); });
+    return success ? 0 : 1;
+}
+
+void dts::scenario_runner::report(std::ostream& out) const {
+    size_t num_succeeded = 0, num_failed = 0, num_skipped = 0;
+    out << "dtest-scenarios: name status seconds scenario log\n";
+    for (const auto& s : this->_scenarios) {
+        using seconds = std::chrono::duration<double>;
+        out << "dtest-scenarios: " << s.name << ' ';
+        if (!s.finished) {
+            out << "not-run";
+            ++num_skipped;
+        } else if (s.succeeded()) {
+            out << "ok";
+            ++num_succeeded;
+        } else if (WIFSIGNALED(s.status)) {
+            out << "signal-" << WTERMSIG(s.status);
+            ++num_failed;
+        } else {
+            out << "exit-code-" << WEXITSTATUS(s.status);
+            ++num_failed;
+        }
+        out << ' ' << std::fixed << std::setprecision(3)
+            << std::chrono::duration_cast<seconds>(s.duration).count()
+            << ' ' << s.path << ' ' << s.log_file << '\n';
+    }
+    out << "dtest-scenarios: " << num_succeeded << " succeeded, " << num_failed << " failed";
+    if (num_skipped != 0) { out << ", " << num_skipped << " not run"; }
+    out << std::endl;
+}
@@ -0,0 +1,81 @@
+#ifndef DTEST_SCENARIOS_HH
+#define DTEST_SCENARIOS_HH
+
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <chrono>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace dts {
+
+    /**
+    \brief Independent dtest invocation.
+    \details Python scenarios (files with ".py" extension) are executed
+    by dtest-python, other files contain whitespace-separated dtest arguments
+    that are quoted as in the shell.
+    */
+    struct scenario {
+        using clock_type = std::chrono::steady_clock;
+        enum class kind_type { python, arguments };
+        std::string path;
+        kind_type kind = kind_type::arguments;
+        /// Default cluster name (the name of the bridge).
+        std::string name;
+        std::string network;
+        std::string peer_network;
+        std::string log_file;
+        ::pid_t id = 0;
+        int status = 0;
+        bool finished = false;
+        clock_type::time_point start{};
+        clock_type::duration duration{};
+
+        inline bool succeeded() const noexcept {
+            return this->finished && WIFEXITED(this->status) && WEXITSTATUS(this->status) == 0;
+        }
+    };
+
+    /**
+    \brief Runs independent scenarios concurrently.
+    \details Every scenario gets unique cluster name and non-overlapping
+    networks via DTEST_NAME, DTEST_NETWORK and DTEST_PEER_NETWORK environment
+    variables. The scenarios are launched as long as the sum of their CPU and
+    memory requirements fits into the budget.
+    */
+    class scenario_runner {
+
+    private:
+        std::vector<scenario> _scenarios;
+        size_t _max_cpus = 0;
+        size_t _cpus_per_scenario = 1;
+        size_t _max_memory = 0;
+        size_t _memory_per_scenario = 0;
+        unsigned _prefix = 24;
+        std::string _output_directory{"dtest-logs"};
+        std::string _dtest{"dtest"};
+        std::string _dtest_python{"dtest-python"};
+
+    public:
+        scenario_runner();
+        void usage();
+        void init(int argc, char* argv[]);
+        /// \return zero if all scenarios succeeded
+        int run();
+
+        inline const std::vector<scenario>& scenarios() const noexcept {
+            return this->_scenarios;
+        }
+
+    private:
+        void allocate();
+        void launch(scenario& s);
+        void report(std::ostream& out) const;
+
+    };
+
+}
+
+#endif // vim:filetype=cpp
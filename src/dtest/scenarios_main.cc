@@ -0,0 +1,16 @@
+#include <iostream>
+
+#include <dtest/scenarios.hh>
+
+int main(int argc, char* argv[]) {
+    int ret = 0;
+    try {
+        dts::scenario_runner runner;
+        runner.init(argc, argv);
+        ret = runner.run();
+    } catch (const std::exception& err) {
+        std::cerr << err.what() << std::endl;
+        ret = 1;
+    }
+    return ret;
+}
@@ -0,0 +1,354 @@
+#ifndef DTEST_STATIC_PATTERN_HH
+#define DTEST_STATIC_PATTERN_HH
+
+#if __cplusplus < 202002L
+#error "dtest/static_pattern.hh requires C++20 (compile with -std=c++20)"
+#endif
+
+#include <array>
+#include <cstddef>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <dtest/line_array.hh>
+
+/**
+\file
+\brief Optional C++20 event matchers that are specialised at compile time.
+\details The patterns are template arguments, they are parsed when the test
+is compiled, hence a bad pattern fails the build, and matching neither compiles
+regular expressions nor allocates memory. The patterns are a subset
+of ECMAScript regular expressions that are matched against the whole line
+(like \link expect_event_sequence \endlink does):
+- literal characters and escaped special characters (<code>\\.</code>, <code>\\[</code> etc.),
+- <code>.</code>, <code>\\d</code>, <code>\\D</code>, <code>\\w</code>,
+  <code>\\W</code>, <code>\\s</code>, <code>\\S</code>,
+- <code>*</code>, <code>+</code>, <code>?</code> quantifiers (greedy or lazy),
+- optional <code>^</code> and <code>$</code> anchors at the ends of the pattern.
+
+Literal patterns are matched with a single comparison, literal prefixes followed
+by <code>.*</code> compare only the prefix.
+\code
+dts::expect_event_sequence<"^x1: leader elected$", "^x2: joined x1$">(lines);
+dts::expect_event_count<"^x\\d+: started$">(lines, 2);
+\endcode
+Use the regular functions for the patterns with groups, alternatives,
+character sets and counted repetitions.
+*/
+
+namespace dts {
+
+    /// String literal that can be used as a template argument.
+    template <size_t N>
+    struct fixed_string {
+        char data[N]{};
+
+        constexpr fixed_string(const char (&s)[N]) noexcept {
+            for (size_t i=0; i<N; ++i) { this->data[i] = s[i]; }
+        }
+
+        constexpr size_t size() const noexcept { return N-1; }
+        constexpr char operator[](size_t i) const noexcept { return this->data[i]; }
+        constexpr std::string_view view() const noexcept { return {this->data, N-1}; }
+    };
+
+    namespace bits {
+
+        enum class atom_kind: unsigned char {
+            literal, any, digit, not_digit, word, not_word, space, not_space
+        };
+
+        enum class quantifier: unsigned char { one, optional, star, plus };
+
+        struct pattern_token {
+            atom_kind kind = atom_kind::literal;
+            quantifier count = quantifier::one;
+            char ch = 0;
+        };
+
+        template <size_t N>
+        struct parsed_pattern {
+            std::array<pattern_token,N> tokens{};
+            size_t size = 0;
+            /// The number of leading single literal characters.
+            size_t prefix_size = 0;
+            /// Leading literal characters.
+            std::array<char,N> prefix{};
+        };
+
+        constexpr bool is_digit(char c) noexcept { return c >= '0' && c <= '9'; }
+
+        constexpr bool is_word(char c) noexcept {
+            return is_digit(c) || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+        }
+
+        constexpr bool is_space(char c) noexcept {
+            return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+        }
+
+        constexpr bool matches(pattern_token t, char c) noexcept {
+            switch (t.kind) {
+                case atom_kind::literal: return c == t.ch;
+                case atom_kind::any: return c != '\n' && c != '\r';
+                case atom_kind::digit: return is_digit(c);
+                case atom_kind::not_digit: return !is_digit(c);
+                case atom_kind::word: return is_word(c);
+                case atom_kind::not_word: return !is_word(c);
+                case atom_kind::space: return is_space(c);
+                case atom_kind::not_space: return !is_space(c);
+            }
+            return false;
+        }
+
+        /// Backtracking matcher: recursion happens only on quantified atoms.
+        constexpr bool
+        match(const pattern_token* first, const pattern_token* last,
+              const char* s, const char* e) noexcept {
+            for (; first != last; ++first) {
+                const auto t = *first;
+                switch (t.count) {
+                    case quantifier::one:
+                        if (s == e || !matches(t, *s)) { return false; }
+                        ++s;
+                        break;
+                    case quantifier::optional:
+                        if (s != e && matches(t, *s) && match(first+1, last, s+1, e)) {
+                            return true;
+                        }
+                        break;
+                    case quantifier::star:
+                    case quantifier::plus: {
+                        const auto min = t.count == quantifier::plus ? 1 : 0;
+                        auto p = s;
+                        while (p != e && matches(t, *p)) { ++p; }
+                        if (p-s < min) { return false; }
+                        for (; p-s != min; --p) {
+                            if (match(first+1, last, p, e)) { return true; }
+                        }
+                        s = p;
+                        break;
+                    }
+                }
+            }
+            return s == e;
+        }
+
+        template <size_t N>
+        consteval parsed_pattern<N> parse(const fixed_string<N>& s) {
+            parsed_pattern<N> p;
+            size_t i = 0, n = s.size();
+            if (i != n && s[i] == '^') { ++i; }
+            while (i != n) {
+                pattern_token t;
+                const char c = s[i++];
+                switch (c) {
+                    case '\\':
+                        if (i == n) { throw std::invalid_argument("trailing backslash"); }
+                        switch (const char e = s[i++]) {
+                            case 'd': t.kind = atom_kind::digit; break;
+                            case 'D': t.kind = atom_kind::not_digit; break;
+                            case 'w': t.kind = atom_kind::word; break;
+                            case 'W': t.kind = atom_kind::not_word; break;
+                            case 's': t.kind = atom_kind::space; break;
+                            case 'S': t.kind = atom_kind::not_space; break;
+                            case 't': t.ch = '\t'; break;
+                            case 'n': t.ch = '\n'; break;
+                            case 'r': t.ch = '\r'; break;
+                            case '.': case '^': case '$': case '|': case '(': case ')':
+                            case '[': case ']': case '{': case '}': case '*': case '+':
+                            case '?': case '\\': case '/': case '-':
+                                t.ch = e;
+                                break;
+                            default: throw std::invalid_argument("unsupported escape sequence");
+                        }
+                        break;
+                    case '.': t.kind = atom_kind::any; break;
+                    case '$':
+                        if (i != n) { throw std::invalid_argument("$ is not at the end"); }
+                        continue;
+                    case '^': throw std::invalid_argument("^ is not at the beginning");
+                    case '(': case ')': throw std::invalid_argument("groups are not supported");
+                    case '|': throw std::invalid_argument("alternatives are not supported");
+                    case '[': case ']': throw std::invalid_argument("character sets are not supported");
+                    case '{': case '}': throw std::invalid_argument("counted repetitions are not supported");
+                    case '*': case '+': case '?': throw std::invalid_argument("nothing to repeat");
+                    default: t.ch = c; break;
+                }
+                if (i != n) {
+                    switch (s[i]) {
+                        case '*': t.count = quantifier::star; ++i; break;
+                        case '+': t.count = quantifier::plus; ++i; break;
+                        case '?': t.count = quantifier::optional; ++i; break;
+                        case '{': throw std::invalid_argument("counted repetitions are not supported");
+                        default: break;
+                    }
+                    // lazy quantifiers match the same lines as greedy ones
+                    if (t.count != quantifier::one && i != n && s[i] == '?') { ++i; }
+                    if (t.count != quantifier::one && i != n &&
+                        (s[i] == '*' || s[i] == '+' || s[i] == '?')) {
+                        throw std::invalid_argument("nothing to repeat");
+                    }
+                }
+                if (p.prefix_size == p.size && t.kind == atom_kind::literal &&
+                    t.count == quantifier::one) {
+                    p.prefix[p.prefix_size++] = t.ch;
+                }
+                p.tokens[p.size++] = t;
+            }
+            return p;
+        }
+
+    }
+
+    /// Pattern that is parsed at compile time.
+    template <fixed_string Pattern>
+    struct static_pattern {
+
+        static constexpr auto parsed = bits::parse(Pattern);
+
+        static constexpr std::string_view prefix() noexcept {
+            return {parsed.prefix.data(), parsed.prefix_size};
+        }
+
+        /// \return true if the pattern matches the whole line
+        static constexpr bool match(std::string_view line) noexcept {
+            return match_rest(0, line);
+        }
+
+        /**
+        \return true if the pattern matches the whole line with its prefix
+        \details The prefix of the line is compared with the literal prefix
+        of the pattern, the line is rendered with the prefix only when
+        the pattern does not start with the prefix (e.g. <code>^x\\d: </code>).
+        */
+        static bool match(const line& l) {
+            const std::string_view p(l.prefix, l.prefix_size), text(l.data, l.size);
+            if (p.empty()) { return match(text); }
+            if (parsed.prefix_size >= p.size()) {
+                return prefix().substr(0, p.size()) == p && match_rest(p.size(), text);
+            }
+            if (p.substr(0, parsed.prefix_size) != prefix()) { return false; }
+            thread_local std::string buffer;
+            buffer.assign(p);
+            buffer.append(text);
+            return match(buffer);
+        }
+
+        static constexpr std::string_view string() noexcept { return Pattern.view(); }
+
+    private:
+
+        /// Match the pattern without the first \p k characters of the literal prefix.
+        static constexpr bool match_rest(size_t k, std::string_view line) noexcept {
+            const auto rest = prefix().substr(k);
+            if (line.substr(0, rest.size()) != rest) { return false; }
+            line.remove_prefix(rest.size());
+            if constexpr (parsed.size == parsed.prefix_size) {
+                return line.empty();
+            } else if constexpr (parsed.size == parsed.prefix_size+1 &&
+                                 parsed.tokens[parsed.prefix_size].kind == bits::atom_kind::any &&
+                                 parsed.tokens[parsed.prefix_size].count == bits::quantifier::star) {
+                return line.find_first_of("\r\n") == std::string_view::npos;
+            } else {
+                const auto* first = parsed.tokens.data();
+                return bits::match(first + parsed.prefix_size, first + parsed.size,
+                                   line.data(), line.data() + line.size());
+            }
+        }
+
+    };
+
+    /// Patterns that have to match lines in order.
+    template <fixed_string ... Patterns>
+    struct static_sequence {
+
+        static constexpr const size_t size = sizeof...(Patterns);
+        static_assert(size != 0, "no patterns");
+
+        /// \return the number of patterns that matched in order
+        template <class Iterator> static size_t
+        count_matched(Iterator first, Iterator last) {
+            size_t k = 0;
+            for (; first != last && k != size; ++first) {
+                if (match_at(k, *first, std::make_index_sequence<size>())) {
+                    ++k;
+                }
+            }
+            return k;
+        }
+
+        [[noreturn]] static void throw_unmatched(size_t first) {
+            static constexpr const std::array<std::string_view,size> strings{
+                static_pattern<Patterns>::string()...};
+            std::stringstream msg;
+            msg << "unmatched expressions: \n";
+            for (size_t i=first; i<size; ++i) { msg << strings[i] << '\n'; }
+            throw std::runtime_error(msg.str());
+        }
+
+    private:
+
+        template <class Line, size_t ... I> static inline bool
+        match_at(size_t k, const Line& line, std::index_sequence<I...>) {
+            bool result = false;
+            static_cast<void>(((k == I && (result = static_pattern<Patterns>::match(line), true)) || ...));
+            return result;
+        }
+
+    };
+
+    template <fixed_string ... Patterns> inline void
+    expect_event_sequence(const string_array& lines) {
+        using sequence = static_sequence<Patterns...>;
+        auto k = sequence::count_matched(lines.begin(), lines.end());
+        if (k != sequence::size) { sequence::throw_unmatched(k); }
+    }
+
+    /// Check event sequence in all lines including the ones spilled to the temporary file.
+    template <fixed_string ... Patterns> inline void
+    expect_event_sequence(const line_array& lines) {
+        using sequence = static_sequence<Patterns...>;
+        auto k = sequence::count_matched(lines.begin(), lines.end());
+        if (k != sequence::size) { sequence::throw_unmatched(k); }
+    }
+
+    template <fixed_string Pattern> inline void
+    expect_event(const string_array& lines) { expect_event_sequence<Pattern>(lines); }
+
+    template <fixed_string Pattern> inline void
+    expect_event(const line_array& lines) { expect_event_sequence<Pattern>(lines); }
+
+    namespace bits {
+
+        template <fixed_string Pattern, class Lines> inline void
+        expect_event_count(const Lines& lines, size_t expected_count) {
+            size_t count = 0;
+            for (const auto& line : lines) {
+                if (static_pattern<Pattern>::match(line)) { ++count; }
+            }
+            if (count != expected_count) {
+                std::stringstream msg;
+                msg << "bad event count: expected=" << expected_count << ",actual=" << count;
+                throw std::runtime_error(msg.str());
+            }
+        }
+
+    }
+
+    template <fixed_string Pattern> inline void
+    expect_event_count(const string_array& lines, size_t expected_count) {
+        bits::expect_event_count<Pattern>(lines, expected_count);
+    }
+
+    /// Count events in all lines including the ones spilled to the temporary file.
+    template <fixed_string Pattern> inline void
+    expect_event_count(const line_array& lines, size_t expected_count) {
+        bits::expect_event_count<Pattern>(lines, expected_count);
+    }
+
+}
+
+#endif // vim:filetype=cpp
@@ -0,0 +1,54 @@
+#include <dtest/thread_pool.hh>
+
+dts::thread_pool::thread_pool(size_t num_threads) {
+    this->_threads.reserve(num_threads);
+    for (size_t i=0; i<num_threads; ++i) {
+        this->_threads.emplace_back([this] () { loop(); });
+    }
+}
+
+dts::thread_pool::~thread_pool() {
+    {
+        lock_type lock(this->_mutex);
+        this->_stopped = true;
+    }
+    this->_task_available.notify_all();
+    for (auto& thread : this->_threads) {
+        if (thread.joinable()) { thread.join(); }
+    }
+}
+
+void dts::thread_pool::submit(task_type task) {
+    {
+        lock_type lock(this->_mutex);
+        this->_tasks.emplace(std::move(task));
+    }
+    this->_task_available.notify_one();
+}
+
+void dts::thread_pool::wait() {
+    lock_type lock(this->_mutex);
+    this->_tasks_completed.wait(lock, [this] () {
+        return this->_tasks.empty() && this->_num_active == 0;
+    });
+}
+
+void dts::thread_pool::loop() {
+    lock_type lock(this->_mutex);
+    while (true) {
+        this->_task_available.wait(lock, [this] () {
+            return this->_stopped || !this->_tasks.empty();
+        });
+        if (this->_stopped) { break; }
+        auto task = std::move(this->_tasks.front());
+        this->_tasks.pop();
+        ++this->_num_active;
+        lock.unlock();
+        task();
+        lock.lock();
+        --this->_num_active;
+        if (this->_tasks.empty() && this->_num_active == 0) {
+            this->_tasks_completed.notify_all();
+        }
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef DTEST_THREAD_POOL_HH
+#define DTEST_THREAD_POOL_HH
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace dts {
+
+    /// Fixed number of threads that execute tasks in FIFO order.
+    class thread_pool {
+
+    public:
+        using task_type = std::function<void()>;
+
+    private:
+        using mutex_type = std::mutex;
+        using lock_type = std::unique_lock<mutex_type>;
+
+    private:
+        std::vector<std::thread> _threads;
+        std::queue<task_type> _tasks;
+        mutex_type _mutex;
+        std::condition_variable _task_available;
+        std::condition_variable _tasks_completed;
+        size_t _num_active = 0;
+        bool _stopped = false;
+
+    public:
+
+        explicit thread_pool(size_t num_threads);
+        ~thread_pool();
+        thread_pool(const thread_pool&) = delete;
+        thread_pool& operator=(const thread_pool&) = delete;
+        thread_pool(thread_pool&&) = delete;
+        thread_pool& operator=(thread_pool&&) = delete;
+
+        void submit(task_type task);
+
+        /// Wait until all submitted tasks are completed.
+        void wait();
+
+        inline size_t size() const noexcept { return this->_threads.size(); }
+
+    private:
+        void loop();
+
+    };
+
+}
+
+#endif // vim:filetype=cpp
@@ -0,0 +1,81 @@
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <stdexcept>
+#include <system_error>
+
+#include <dtest/waiter.hh>
+
+constexpr const int dts::process_waiter::unknown_status;
+
+dts::line_waiter::line_waiter(const string_array& regex_strings, std::string prefix,
+                              size_type first, callback_type callback):
+_prefix(std::move(prefix)), _position(first), _callback(std::move(callback)) {
+    if (regex_strings.empty()) { throw std::invalid_argument("no regular expressions"); }
+    for (const auto& s : regex_strings) { this->_expressions.emplace_back(s); }
+}
+
+bool dts::line_waiter::screen(const line_array& lines) {
+    const auto num_expressions = this->_expressions.size();
+    if (this->_position < lines.appended()) {
+        line_array::const_iterator first(&lines, lines.index(this->_position));
+        line_array::const_iterator last = lines.end();
+        for (; first != last && this->_matched.size() != num_expressions; ++first) {
+            const auto& line = *first;
+            this->_position = lines.position(first.index())+1;
+            const auto prefix_size = this->_prefix.size();
+            if (prefix_size != 0 && (line.prefix_size != prefix_size ||
+                this->_prefix.compare(0, prefix_size, line.prefix, prefix_size) != 0)) {
+                continue;
+            }
+            const auto& expr = this->_expressions[this->_matched.size()];
+            if (expr.search(line)) {
+                this->_matched.emplace_back(line.str());
+            }
+        }
+    }
+    if (this->_matched.size() != num_expressions) { return false; }
+    this->_callback(this->_matched, this->_position-1);
+    return true;
+}
+
+dts::process_waiter::process_waiter(std::vector<::pid_t> processes, callback_type callback):
+_processes(std::move(processes)), _callback(std::move(callback)) {
+    #if defined(SYS_pidfd_open)
+    for (auto pid : this->_processes) {
+        int fd = ::syscall(SYS_pidfd_open, pid, 0);
+        // older kernels: rely on closed output pipes to wake up the poller
+        if (fd == -1) { break; }
+        this->_descriptors.emplace_back(fd);
+    }
+    #endif
+}
+
+bool dts::process_waiter::screen() {
+    const auto num_processes = this->_processes.size();
+    status_array statuses;
+    statuses.reserve(num_processes);
+    bool all_exited = true;
+    for (size_t i=0; i<num_processes; ++i) {
+        ::siginfo_t info{};
+        if (::waitid(P_PID, this->_processes[i], &info,
+                     WEXITED | WNOHANG | WNOWAIT) == -1) {
+            if (errno != ECHILD) { throw std::system_error(errno, std::generic_category()); }
+            statuses.emplace_back(unknown_status);
+        } else if (info.si_pid == 0) {
+            // si_pid is zero when the process is still running
+            all_exited = false;
+            continue;
+        } else {
+            statuses.emplace_back(info.si_code == CLD_EXITED ? info.si_status : -info.si_status);
+        }
+        // the descriptor of the exited process stays readable, closing it
+        // removes it from the poller that would otherwise wake up in a loop
+        if (i < this->_descriptors.size()) { this->_descriptors[i].close(); }
+    }
+    if (!all_exited) { return false; }
+    this->_callback(statuses);
+    return true;
+}
@@ -0,0 +1,118 @@
+#ifndef DTEST_WAITER_HH
+#define DTEST_WAITER_HH
+
+#include <sys/types.h>
+
+#include <functional>
+#include <limits>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include <unistdx/io/fildes>
+
+#include <dtest/line_array.hh>
+
+namespace dts {
+
+    /**
+    \brief Waits for the lines that match regular expressions in order.
+    \details Every line is matched only once: the waiter remembers
+    the position of the next line (\link line_array::position \endlink)
+    and continues from it when new lines arrive.
+    The callback is called exactly once when the last expression matches.
+    */
+    class line_waiter {
+
+    public:
+        using size_type = line_array::size_type;
+        /// Receives the matched lines and the position of the last one.
+        using callback_type = std::function<void(const string_array&,size_type)>;
+
+    private:
+        std::vector<line_regex> _expressions;
+        std::string _prefix;
+        size_type _position = 0;
+        string_array _matched;
+        callback_type _callback;
+
+    public:
+
+        /**
+        \param[in] regex_strings expressions that lines have to match in order
+        \param[in] prefix match only the lines that start with the prefix
+        (node name followed by colon) or all lines if the prefix is empty
+        \param[in] first the position of the first line to match
+        */
+        line_waiter(const string_array& regex_strings, std::string prefix,
+                    size_type first, callback_type callback);
+
+        /// Match the lines that were not screened yet.
+        /// \return true if all expressions matched and the callback was called
+        bool screen(const line_array& lines);
+
+    };
+
+    /// Calls the callback once when the deadline is reached.
+    class timer_waiter {
+
+    public:
+        using time_point = line_info::time_point;
+        using callback_type = std::function<void()>;
+
+    private:
+        time_point _deadline;
+        callback_type _callback;
+
+    public:
+        inline timer_waiter(time_point deadline, callback_type callback):
+        _deadline(deadline), _callback(std::move(callback)) {}
+
+        inline time_point deadline() const noexcept { return this->_deadline; }
+
+        /// \return true if the deadline is reached and the callback was called
+        inline bool screen(time_point now) {
+            if (now < this->_deadline) { return false; }
+            this->_callback();
+            return true;
+        }
+
+    };
+
+    /**
+    \brief Waits until all processes exit.
+    \details The processes are not reaped, hence the exit status is available
+    for \link application::wait \endlink later. When the kernel supports
+    process file descriptors, they are added to the poller to wake it up
+    when the process exits, and are closed as soon as their process exits.
+    */
+    class process_waiter {
+
+    public:
+        using status_array = std::vector<int>;
+        /// Receives exit codes of the processes (negative signal numbers
+        /// for the processes that were terminated by a signal).
+        using callback_type = std::function<void(const status_array&)>;
+        /// The process was reaped by somebody else.
+        static constexpr const int unknown_status = std::numeric_limits<int>::min();
+
+    private:
+        std::vector<::pid_t> _processes;
+        std::vector<sys::fildes> _descriptors;
+        callback_type _callback;
+
+    public:
+        process_waiter(std::vector<::pid_t> processes, callback_type callback);
+
+        /// \return true if all processes exited and the callback was called
+        bool screen();
+
+        inline const std::vector<sys::fildes>& descriptors() const noexcept {
+            return this->_descriptors;
+        }
+
+    };
+
+}
+
+#endif // vim:filetype=cpp
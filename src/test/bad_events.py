@@ -0,0 +1,23 @@
+import sys
+import dtest
+emit = '''
+import os, struct, sys
+fd = int(os.environ["DTEST_EVENT_FD"])
+if sys.argv[1] == "bad":
+    # the record is shorter than the event identifier
+    os.write(fd, struct.pack("<IH", 2, 1))
+    os.write(fd, struct.pack("<II", 4, 9))
+else:
+    for id in (1, 2, 3):
+        os.write(fd, struct.pack("<II", 4, id))
+print("done")
+'''
+dtest.cluster(name="x",size=2)
+dtest.exit_code("all")
+dtest.add_process([0], [sys.executable, "-c", emit, "bad"])
+dtest.add_process([1], [sys.executable, "-c", emit, "good"])
+dtest.add_test('events of the other node are received',
+    lambda lines: dtest.expect_events([(1,1), (2,1), (3,1)]))
+dtest.add_test('events after malformed record are discarded',
+    lambda lines: dtest.expect_event_id_count(9, 0), triggers=['^x1: done$'])
+dtest.run()
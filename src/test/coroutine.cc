@@ -0,0 +1,63 @@
+#include <chrono>
+#include <iostream>
+
+#include <dtest/coroutine.hh>
+
+sys::argstream shell(const char* script) {
+    sys::argstream args;
+    args.append("sh");
+    args.append("-c");
+    args.append(script);
+    return args;
+}
+
+dts::coroutine crash_and_recovery(dts::coroutine_context& ctx) {
+    auto line = co_await ctx.event("^x1: started$", 0);
+    if (line != "x1: started") { throw std::runtime_error("bad line: " + line); }
+    ctx->kill_process(0, sys::signal::kill);
+    auto statuses = co_await ctx.exited(0);
+    if (statuses.size() != 1 || statuses.front() != -9) {
+        throw std::runtime_error("bad exit status");
+    }
+    co_await ctx.sleep(std::chrono::milliseconds(100));
+    ctx->run_process(0, shell("echo recovered; echo joined"));
+    dts::string_array expected{"^x1: recovered$", "^x1: joined$"};
+    co_await ctx.sequence(std::move(expected), 0);
+}
+
+dts::coroutine discarded_lines(dts::coroutine_context& ctx) {
+    // the lines before the marker are discarded while the context points after it
+    co_await ctx.event("^x2: marker$", 1);
+    auto line = co_await ctx.event("^x2: (marker|end)$", 1);
+    if (line != "x2: end") { throw std::runtime_error("bad line: " + line); }
+}
+
+int main(int argc, char* argv[]) {
+    using namespace std::chrono;
+    int ret = 0;
+    dts::application app;
+    try {
+        dts::cluster c;
+        c.read_environment();
+        c.name("x");
+        c.generate_nodes(2);
+        app.cluster(std::move(c));
+        app.exit_code(dts::to_exit_code("all"));
+        app.timeout(duration_cast<dts::line_info::clock_type::duration>(seconds(30)));
+        app.add_process(dts::cluster_node_bitmap(2, {0,1}),
+                        shell("echo started; exec sleep 100"));
+        app.add_process(dts::cluster_node_bitmap(2, {1}),
+                        shell("seq -f 'filler %g' 1 50000; sleep 1; echo marker; "
+                              "seq -f 'filler %g' 1 50000; sleep 1; echo end"));
+        app.max_line_memory(1024UL*1024UL);
+        app.retain_lines("^x1: |^x2: (started|marker|end)$");
+        app.add_test(dts::make_coroutine_test("crash and recovery", crash_and_recovery));
+        app.add_test(dts::make_coroutine_test("discarded lines", discarded_lines));
+        ret = run(app);
+    } catch (const std::exception& err) {
+        std::cerr << err.what() << std::endl;
+        app.terminate();
+        ret = 1;
+    }
+    return ret;
+}
@@ -0,0 +1,22 @@
+import dtest
+
+async def crash_and_recovery():
+    await dtest.event('^x1: started$', node=0, timeout=10)
+    dtest.kill_node([0], 9)
+    statuses = await dtest.exited(0, timeout=10)
+    assert statuses == [-9], statuses
+    dtest.run_process([0], ["sh", "-c", "echo recovered"])
+    await dtest.sequence(['^x1: recovered$'], node=0, timeout=10)
+
+async def earlier_line():
+    # every coroutine test has its own cursor, the line that was captured
+    # before the lines that resolved the previous test is still matched
+    await dtest.event('^x2: started$', node=1, timeout=10)
+
+dtest.cluster(name="x",size=2)
+dtest.exit_code("all")
+dtest.timeout(30)
+dtest.add_process([0,1], ["sh", "-c", "echo started; exec sleep 100"])
+dtest.add_test('crash and recovery', crash_and_recovery)
+dtest.add_test('earlier line', earlier_line)
+dtest.run()
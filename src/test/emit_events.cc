@@ -0,0 +1,16 @@
+#include <cstdint>
+#include <cstdlib>
+
+#include <dtest/event.hh>
+
+// Emits events with identifiers from one to n (the first argument, three by default)
+// via the header-only emitter. The payload of each event is its identifier
+// multiplied by ten as 64-bit integer.
+int main(int argc, char* argv[]) {
+    const std::uint32_t n = argc > 1 ? std::atoi(argv[1]) : 3;
+    for (std::uint32_t id=1; id<=n; ++id) {
+        const std::uint64_t payload = id*10;
+        if (!dts::events::emit(id, payload)) { return 1; }
+    }
+    return 0;
+}
@@ -0,0 +1,20 @@
+import os
+import struct
+import dtest
+
+def payloads_are_intact(lines):
+    events = dtest.events()
+    if len(events) != 6: raise ValueError('bad number of events: %d' % len(events))
+    for timestamp, node, id, payload in events:
+        if struct.unpack('=Q', payload)[0] != id*10: raise ValueError('bad payload: %r' % payload)
+
+dtest.cluster(name="x",size=2)
+dtest.exit_code("all")
+if os.environ.get('DTEST_EVENT_RING_SIZE'):
+    # the events never reach the watermark and are delivered when the processes exit
+    dtest.event_ring(int(os.environ['DTEST_EVENT_RING_SIZE']), watermark=1024*1024)
+dtest.add_process([0,1], [os.environ['DTEST_EMIT_EVENTS']])
+dtest.add_test('event sequence', lambda lines: dtest.expect_events([1, (2,0), (3,1)]))
+dtest.add_test('event count', lambda lines: dtest.expect_event_id_count(2, 2))
+dtest.add_test('event payload', payloads_are_intact)
+dtest.run()
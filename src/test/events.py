@@ -0,0 +1,15 @@
+import sys
+import dtest
+emit = '''
+import os, struct
+fd = int(os.environ["DTEST_EVENT_FD"])
+for id in (1, 2, 3):
+    payload = struct.pack("<Q", id*10)
+    os.write(fd, struct.pack("<II", 4+len(payload), id) + payload)
+'''
+dtest.cluster(name="x",size=2)
+dtest.exit_code("all")
+dtest.add_process([0,1], [sys.executable, "-c", emit])
+dtest.add_test('event sequence', lambda lines: dtest.expect_events([1, (2,0), (3,1)]))
+dtest.add_test('event count', lambda lines: dtest.expect_event_id_count(2, 2))
+dtest.run()
@@ -0,0 +1,20 @@
+import dtest
+
+def test_lines(lines):
+    # dtest.Lines are matched in C++
+    dtest.expect_event_sequence(lines, ['^x1: first$', '^x1: second$'])
+    dtest.expect_event_count(lines, '^x\\d: first$', 2)
+    # the prefix belongs to the first alternative only
+    dtest.expect_event_count(lines, '^x1: first|x2: second', 2)
+    dtest.expect_event_count(lines, '^x1: first$|^x2: second$', 2)
+    dtest.expect_event_count(lines, '^x1: (first|second)$', 2)
+    # Python lists are still accepted
+    copy = [str(line) for line in lines]
+    dtest.expect_event_sequence(copy, ['^x2: first$', '^x2: second$'])
+    dtest.expect_event_count(copy, '^x\\d: second$', 2)
+
+dtest.cluster(name="x",size=2)
+dtest.exit_code("all")
+dtest.add_process([0,1], ["sh", "-c", "echo first; echo second"])
+dtest.add_test('native lines', test_lines)
+dtest.run()
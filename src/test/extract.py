@@ -0,0 +1,20 @@
+import dtest
+
+def test_extract(lines):
+    dtest.expect_event_count(lines, '^x\\d: done$', 2)
+    columns = dtest.extract('request (\\d+) took ([0-9.]+)ms', fields=[('id', int), 'latency'])
+    assert sorted(columns['id'].tolist()) == [1, 1, 2, 2], columns['id'].tolist()
+    assert sorted(columns['latency'].tolist()) == [0.5, 1.5, 2.5, 3.5], columns['latency'].tolist()
+    assert sorted(columns['node'].tolist()) == [0, 0, 1, 1], columns['node'].tolist()
+    assert len(columns['timestamp']) == 4
+    node1 = dtest.extract('request (\\d+) took ([0-9.]+)ms', node=1)
+    assert node1['node'].tolist() == [1, 1], node1['node'].tolist()
+    assert node1['2'].tolist() == [2.5, 3.5], node1['2'].tolist()
+
+script = 'i=$(hostname | tr -d x); echo "request 1 took $((2*i-2)).5ms"; ' \
+    'echo "request 2 took $((2*i-1)).5ms"; echo done'
+dtest.cluster(name="x",size=2)
+dtest.exit_code("all")
+dtest.add_process([0,1], ["sh", "-c", script])
+dtest.add_test('extract', test_extract)
+dtest.run()
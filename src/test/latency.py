@@ -0,0 +1,19 @@
+import os
+import dtest
+
+# the processes sleep 100 milliseconds between start and end, hence the bounds
+# below 100 milliseconds must fail (see the expected failures in meson.build)
+max_latency = float(os.environ.get('DTEST_LATENCY_MAX', '5000'))
+p50_latency = float(os.environ.get('DTEST_LATENCY_P50', '5000'))
+
+dtest.cluster(name="x",size=2)
+dtest.exit_code("all")
+dtest.add_process([0,1], ["sh", "-c", "echo start; sleep 0.1; echo end"])
+dtest.add_test('latency between start and end',
+    lambda lines: dtest.expect_latency(lines, '^x1: start$', '^x1: end$', max_latency),
+    timeout=5)
+dtest.add_test('latency percentiles',
+    lambda lines: dtest.expect_latency_percentiles(lines, '^(x.*): start$', '^(x.*): end$',
+                                                   p50=p50_latency, max=5000),
+    timeout=5)
+dtest.run()
@@ -0,0 +1,8 @@
+import dtest
+dtest.cluster(name="x",size=2)
+dtest.exit_code("all")
+dtest.buffers(max_line_length=9000)
+dtest.add_process([0,1], ["python3", "-c", "print('a'*8000); print('b'*12000); print('end')"])
+dtest.add_test('long line is captured', lambda lines: dtest.expect_event_sequence(lines, ['^x1: a{8000}$']))
+dtest.add_test('longer line is truncated', lambda lines: dtest.expect_event_sequence(lines, ['^x1: b{9000}$', '^x1: end$']))
+dtest.run()
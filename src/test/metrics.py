@@ -0,0 +1,43 @@
+import os
+import sys
+import tempfile
+import dtest
+
+n = 100
+
+def check_stats_file(filename):
+    with open(filename) as f:
+        lines = f.read().splitlines()
+    keys = set(line.split(' ')[0] for line in lines)
+    for key in ('wakeups', 'copy_ns', 'run_tests_ns', 'line_memory', 'events'):
+        if key not in keys: raise ValueError('no %s in stats file' % key)
+    if not any(line.startswith('test_ns "all lines are counted" count 1 ') for line in lines):
+        raise ValueError('no test duration in stats file')
+    # "stream <index> <name> lines <n> bytes <n> stalls <n> truncated <n>"
+    counts = {}
+    for line in lines:
+        fields = line.split(' ')
+        if fields[0] != 'stream': continue
+        counts[fields[2]] = counts.get(fields[2], 0) + int(fields[4])
+    for name in ('x1', 'x2'):
+        if counts.get(name, 0) < n:
+            raise ValueError('%s: bad number of lines: %d' % (name, counts.get(name, 0)))
+
+directory = tempfile.mkdtemp(prefix='dtest-metrics-')
+filename = os.path.join(directory, 'stats')
+dtest.cluster(name="x",size=2)
+dtest.exit_code("all")
+dtest.metrics(True)
+dtest.stats_file(filename)
+dtest.add_process([0,1], ["sh", "-c", 'for i in $(seq 1 %d); do echo "line $i"; done' % n])
+dtest.add_test('all lines are counted',
+    lambda lines: [dtest.expect_event_count(lines, '^x%d: line %d$' % (i, n), 1) for i in (1,2)])
+ret = dtest.run()
+try:
+    if ret != 0: sys.exit(ret)
+    check_stats_file(filename)
+except (IOError, ValueError) as e:
+    sys.exit('stats file: %s' % e)
+finally:
+    if os.path.exists(filename): os.remove(filename)
+    os.rmdir(directory)
@@ -0,0 +1,21 @@
+import dtest
+
+async def counters():
+    await dtest.exited([0,1], timeout=10)
+    total = dtest.counters()
+    node1 = dtest.counters(node=0)
+    worker = dtest.counters(node=0, process=0)
+    assert set(worker) <= set(node1) and set(node1) == set(total), (worker, node1, total)
+    for name, value in worker.items():
+        assert value <= node1[name] <= total[name], (name, worker, node1, total)
+    if 'instructions' in worker:
+        assert worker['instructions'] > 0, worker
+    assert dtest.counters(node=0, process=5) == {}
+
+dtest.cluster(name="x",size=2)
+dtest.exit_code("all")
+dtest.perf_counters(True)
+dtest.add_process([0,1], ["sh", "-c", "i=0; while [ $i -lt 1000 ]; do i=$((i+1)); done"])
+dtest.add_process([0], ["true"])
+dtest.add_test('counters', counters)
+dtest.run()
@@ -0,0 +1,29 @@
+import dtest
+
+n = 10000
+
+def all_lines_in_stream_order(lines):
+    for i in (1,2,3,4):
+        dtest.expect_event_count(lines, '^x%d: out end$' % i, 1)
+        dtest.expect_event_count(lines, '^x%d: err end$' % i, 1)
+    # stdout and stderr of every node are read by different threads
+    expected = {}
+    for line in lines:
+        name, kind, number = str(line).split(' ')
+        key = name + kind
+        if number == 'end':
+            if expected.get(key, 1) != n+1: raise ValueError('%s: missing lines' % key)
+            continue
+        if int(number) != expected.get(key, 1):
+            raise ValueError('%s: bad order: %s' % (key, number))
+        expected[key] = int(number) + 1
+    if len(expected) != 8: raise ValueError('bad number of streams: %d' % len(expected))
+
+script = 'for i in $(seq 1 %d) end; do echo "out $i"; echo "err $i" >&2; done' % n
+dtest.cluster(name="x",size=4)
+dtest.exit_code("all")
+dtest.readers(3)
+dtest.add_process([0,1,2,3], ["sh", "-c", script])
+dtest.add_test('lines of every stream are in order', all_lines_in_stream_order,
+               triggers=['^x\\d: \\w+ end$'])
+dtest.run()
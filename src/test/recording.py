@@ -0,0 +1,35 @@
+import os
+import struct
+import sys
+import tempfile
+import dtest
+
+directory = tempfile.mkdtemp(prefix='dtest-recording-')
+filename = os.path.join(directory, 'output.rec')
+dtest.cluster(name="x",size=2)
+dtest.exit_code("all")
+dtest.record(filename)
+dtest.add_process([0,1], ["sh", "-c", "echo first; echo second"])
+for i in (1,2):
+    dtest.add_test('node %d lines are recorded' % i,
+        lambda lines, i=i: dtest.expect_event_sequence(lines, [
+            '^x%d: first$' % i, '^x%d: second$' % i]))
+ret = dtest.run()
+if ret != 0: sys.exit(ret)
+# the recording of unsupported version is rejected
+with open(filename, 'rb') as f:
+    data = f.read()
+bad_filename = os.path.join(directory, 'bad.rec')
+with open(bad_filename, 'wb') as f:
+    f.write(data[:8] + struct.pack('=I', 1000) + data[12:])
+try:
+    dtest.replay(bad_filename)
+    sys.exit('recording of unsupported version is accepted')
+except ValueError:
+    pass
+# the same tests succeed for the replayed lines
+ret = dtest.replay(filename)
+os.remove(filename)
+os.remove(bad_filename)
+os.rmdir(directory)
+sys.exit(ret)
@@ -0,0 +1,14 @@
+import dtest
+
+def crash(lines):
+    dtest.expect_event_sequence(lines, ['^x1: started$'])
+    dtest.restart_node(0, delay=0.1)
+
+dtest.cluster(name="x",size=2)
+dtest.exit_code("all")
+dtest.add_process([0,1], ["sh", "-c", "hostname; echo started; exec sleep 100"])
+dtest.add_test('node 1 started', crash)
+dtest.add_test('node 1 restarted in the same namespace',
+               lambda lines: dtest.expect_event_sequence(
+                   lines, ['^x1: started$', '^x1: x1$', '^x1: started$']))
+dtest.run()
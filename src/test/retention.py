@@ -0,0 +1,23 @@
+import dtest
+
+n = 100000
+
+def all_lines_in_order(lines):
+    for i in (1,2):
+        dtest.expect_event_count(lines, '^x%d: end$' % i, 1)
+    # most of the lines were moved to the temporary file and are read by index
+    expected = {'x1': 1, 'x2': 1}
+    for line in lines:
+        name, text = str(line).split(': ', 1)
+        if text == 'end':
+            if expected[name] != n+1: raise ValueError('%s: missing lines' % name)
+            continue
+        if int(text) != expected[name]: raise ValueError('%s: bad order: %s' % (name, text))
+        expected[name] += 1
+
+dtest.cluster(name="x",size=2)
+dtest.exit_code("all")
+dtest.retention(max_memory=1)
+dtest.add_process([0,1], ["sh", "-c", "seq 1 %d; echo end" % n])
+dtest.add_test('spilled lines are read in order', all_lines_in_order, triggers=['^x\\d: end$'])
+dtest.run()
@@ -0,0 +1,26 @@
+import dtest
+
+n = 50000
+
+async def marker_after_discarded_lines():
+    # the waiter is registered before the filler lines arrive and stays pending
+    # while the lines that do not match the filter are discarded
+    line = await dtest.event('^x1: marker$', timeout=10)
+    assert line == 'x1: marker', line
+
+async def cursor_after_discarded_lines():
+    # the cursor points after the marker, and the lines before the marker
+    # are discarded before the next line is awaited
+    await dtest.event('^x1: marker$', timeout=10)
+    line = await dtest.event('^x1: (marker|end)$', timeout=10)
+    assert line == 'x1: end', line
+
+dtest.cluster(name="x",size=1)
+dtest.exit_code("all")
+dtest.timeout(30)
+dtest.retention(max_memory=1, filter='^x1: (ready|marker|end)$')
+dtest.add_process([0], ["sh", "-c",
+    'echo ready; seq -f "filler %%g" 1 %d; sleep 1; echo marker; seq -f "filler %%g" 1 %d; sleep 1; echo end' % (n, n)])
+dtest.add_test('marker after discarded lines', marker_after_discarded_lines)
+dtest.add_test('cursor after discarded lines', cursor_after_discarded_lines)
+dtest.run()
@@ -0,0 +1,22 @@
+import ipaddress
+import os
+import dtest
+
+# the cluster uses the name and the networks that dtest-scenarios assigned
+name = os.environ['DTEST_NAME']
+peer_network = ipaddress.ip_network(os.environ['DTEST_PEER_NETWORK'], strict=False)
+
+def nodes_use_assigned_name_and_network(lines):
+    for i in (1,2):
+        dtest.expect_event_count(lines, '^%s%d: ' % (name, i), 1)
+    for line in lines:
+        node, hostname, address = str(line).split(' ')
+        if node != hostname + ':': raise ValueError('bad hostname: %s' % line)
+        if ipaddress.ip_interface(address).ip not in peer_network:
+            raise ValueError('%s is not in %s' % (address, peer_network))
+
+dtest.cluster(size=2)
+dtest.exit_code("all")
+dtest.add_process([0,1], ["sh", "-c", 'echo "$(hostname) $DTEST_INTERFACE_ADDRESS"'])
+dtest.add_test('nodes use assigned name and network', nodes_use_assigned_name_and_network)
+dtest.run()
@@ -0,0 +1,74 @@
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <dtest/scenarios.hh>
+
+void init(dts::scenario_runner& runner, std::vector<std::string> args) {
+    args.insert(args.begin(), "dtest-scenarios");
+    std::vector<char*> argv;
+    for (auto& a : args) { argv.emplace_back(&a[0]); }
+    argv.emplace_back(nullptr);
+    runner.init(int(args.size()), argv.data());
+}
+
+void expect(const std::string& actual, const std::string& expected) {
+    if (actual != expected) {
+        throw std::runtime_error("expected " + expected + ", got " + actual);
+    }
+}
+
+int main() {
+    int ret = 0;
+    try {
+        {
+            // the same scenario twice does not share the name and the networks
+            dts::scenario_runner runner;
+            init(runner, {"--output", "logs", "a.py", "a.py", "b"});
+            const auto& s = runner.scenarios();
+            if (s.size() != 3) { throw std::runtime_error("bad number of scenarios"); }
+            expect(s[0].name, "a");
+            expect(s[1].name, "b");
+            expect(s[2].name, "c");
+            expect(s[0].network, "10.1.0.1/24");
+            expect(s[1].network, "10.1.1.1/24");
+            expect(s[2].network, "10.1.2.1/24");
+            expect(s[0].peer_network, "10.0.0.1/24");
+            expect(s[1].peer_network, "10.0.1.1/24");
+            expect(s[2].peer_network, "10.0.2.1/24");
+            expect(s[0].log_file, "logs/a-a.py.log");
+            expect(s[1].log_file, "logs/b-a.py.log");
+            if (s[2].kind != dts::scenario::kind_type::arguments) {
+                throw std::runtime_error("bad kind");
+            }
+        }
+        {
+            // the names continue after "z" with two letters
+            dts::scenario_runner runner;
+            init(runner, std::vector<std::string>(28, "a.py"));
+            const auto& s = runner.scenarios();
+            expect(s[25].name, "z");
+            expect(s[26].name, "aa");
+            expect(s[27].name, "ab");
+            expect(s[27].network, "10.1.27.1/24");
+        }
+        {
+            dts::scenario_runner runner;
+            init(runner, {"--prefix", "20", "a.py", "b.py"});
+            expect(runner.scenarios()[1].network, "10.1.16.1/20");
+        }
+        {
+            // /17 prefix leaves room for two scenarios only
+            dts::scenario_runner runner;
+            bool thrown = false;
+            try { init(runner, {"--prefix", "17", "a.py", "b.py", "c.py"}); }
+            catch (const std::invalid_argument&) { thrown = true; }
+            if (!thrown) { throw std::runtime_error("too many scenarios are accepted"); }
+        }
+    } catch (const std::exception& err) {
+        std::cerr << err.what() << std::endl;
+        ret = 1;
+    }
+    return ret;
+}
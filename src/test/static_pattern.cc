@@ -0,0 +1,96 @@
+#include <iostream>
+#include <regex>
+
+#include <dtest/application.hh>
+#include <dtest/static_pattern.hh>
+
+// patterns are matched at compile time too
+static_assert(dts::static_pattern<"^x1: leader elected$">::match("x1: leader elected"));
+static_assert(!dts::static_pattern<"^x1: leader elected$">::match("x1: leader elected!"));
+static_assert(dts::static_pattern<"^x1: .*">::match("x1: anything"));
+static_assert(!dts::static_pattern<"^x1: .*">::match("x2: anything"));
+static_assert(dts::static_pattern<"^x\\d+: joined x\\d+$">::match("x12: joined x1"));
+static_assert(!dts::static_pattern<"^x\\d+: joined x\\d+$">::match("x: joined x1"));
+static_assert(dts::static_pattern<"a.*b.*c">::match("aXbYbc"));
+static_assert(dts::static_pattern<"colou?r\\.">::match("color."));
+static_assert(!dts::static_pattern<"colou?r\\.">::match("colourX"));
+
+template <dts::fixed_string Pattern>
+void compare(const dts::string_array& lines) {
+    std::regex expr(Pattern.data);
+    for (const auto& line : lines) {
+        bool expected = std::regex_match(line, expr);
+        bool actual = dts::static_pattern<Pattern>::match(line);
+        if (expected != actual) {
+            std::stringstream msg;
+            msg << "pattern " << Pattern.data << " line " << line
+                << ": expected=" << expected << ",actual=" << actual;
+            throw std::runtime_error(msg.str());
+        }
+    }
+}
+
+template <class Function>
+bool throws(Function f) {
+    try { f(); } catch (const std::runtime_error&) { return true; }
+    return false;
+}
+
+int main() {
+    int ret = 0;
+    try {
+        dts::string_array lines{
+            "", "x1: leader elected", "x2: joined x1", "x10: joined x2",
+            "x1: started", "x1:  started", "x1: started\t", "x_1: value=-1.5",
+            "x1: a+b", "x1: ab", "aaab", "ab", "b",
+        };
+        compare<"^x1: leader elected$">(lines);
+        compare<"x1: .*">(lines);
+        compare<"^x\\d+: joined x\\d$">(lines);
+        compare<"^\\w+:\\s+started\\s*$">(lines);
+        compare<"^\\S+: value=-?\\d+\\.\\d+$">(lines);
+        compare<"x1: a\\+b">(lines);
+        compare<"a*b">(lines);
+        compare<"a+?b">(lines);
+        compare<".*">(lines);
+        compare<"^$">(lines);
+        dts::expect_event_sequence<"^x1: leader elected$", "^x\\d+: joined x1$">(lines);
+        dts::expect_event<"^x1: started$">(lines);
+        dts::expect_event_count<"^x\\d+: joined x\\d+$">(lines, 2);
+        dts::line_array all_lines;
+        for (const auto& line : lines) { all_lines.emplace_back(std::string(line), {}); }
+        dts::expect_event_sequence<"^x1: leader elected$", "^x\\d+: joined x1$">(all_lines);
+        dts::expect_event_count<"^x\\d+: joined x\\d+$">(all_lines, 2);
+        // lines are stored without prefixes
+        dts::line_array prefixed;
+        prefixed.prefix(0, "x1: ");
+        prefixed.prefix(1, "x10: ");
+        dts::line_info info;
+        prefixed.emplace_back("started", info);
+        info.stream = 1;
+        prefixed.emplace_back("joined x1", info);
+        dts::expect_event_sequence<"^x1: started$", "^x\\d+: joined x1$">(prefixed);
+        dts::expect_event_sequence(prefixed, {"^x1: started$", "^x\\d+: joined x1$"});
+        dts::expect_event_count<"^x1.*">(prefixed, 2);
+        dts::expect_event_count(prefixed, "^x1.*", 2);
+        dts::expect_event_count<"^x1: .*">(prefixed, 1);
+        dts::expect_event_count(prefixed, "^x1: .*", 1);
+        dts::expect_event_count<"started">(prefixed, 0);
+        dts::expect_event_count(prefixed, "started", 0);
+        if (prefixed.strings() != dts::string_array{"x1: started", "x10: joined x1"}) {
+            throw std::runtime_error("bad rendered lines");
+        }
+        if (!throws([&] () {
+            dts::expect_event_sequence<"^x2: joined x1$", "^x1: leader elected$">(lines);
+        })) {
+            throw std::runtime_error("out-of-order sequence matched");
+        }
+        if (!throws([&] () { dts::expect_event_count<"^x1: .*">(lines, 1); })) {
+            throw std::runtime_error("bad count matched");
+        }
+    } catch (const std::exception& err) {
+        std::cerr << err.what() << std::endl;
+        ret = 1;
+    }
+    return ret;
+}
@@ -0,0 +1,10 @@
+import dtest
+dtest.cluster(name="x",size=3)
+dtest.exit_code("all")
+dtest.test_threads(2)
+dtest.add_process([0,1,2], ["hostname"])
+dtest.add_test('hostname 1', lambda lines: dtest.expect_event_sequence(lines, ['^x1: x1$']))
+dtest.add_test('hostname 2', lambda lines: dtest.expect_event_sequence(lines, ['^x2: x2$']))
+dtest.add_test('all hostnames', lambda lines: dtest.expect_event_sequence(lines, ['^x3: x3$']),
+               depends=['hostname 1', 'hostname 2'])
+dtest.run()
@@ -0,0 +1,9 @@
+import dtest
+dtest.cluster(name="x",size=2)
+dtest.exit_code("all")
+dtest.timeout(10)
+dtest.add_process([0,1], ["sleep", "100"])
+dtest.add_test('event that never occurs',
+               lambda lines: dtest.expect_event_sequence(lines, ['^x1: never$']),
+               timeout=1)
+dtest.run()
@@ -0,0 +1,26 @@
+import os
+import dtest
+
+script = 'd=/tmp/dtest-tmpfs; stat -f -c "type %T" $d; ' \
+    'echo $(hostname) > $d/name; echo "files $(ls $d | wc -l)"; ' \
+    'dd if=/dev/zero of=$d/big bs=1M count=2 2>/dev/null || echo full'
+dtest.cluster(name="x",size=2)
+dtest.exit_code("all")
+dtest.tmpfs('/tmp/dtest-tmpfs', size=1)
+dtest.add_process([0,1], ["sh", "-c", script])
+# working directory under the mount point is hidden by the tmpfs
+workdir = '/tmp/dtest-tmpfs/work-%d' % os.getpid()
+os.makedirs(workdir)
+os.chdir(workdir)
+dtest.add_process([0], ["sh", "-c", 'echo "cwd $(pwd)"'])
+dtest.add_test('hidden working directory falls back to the root directory',
+    lambda lines: dtest.expect_event_count(lines, '^x1: cwd /$', 1))
+for i in (1,2):
+    dtest.add_test('node %d has private tmpfs' % i,
+        lambda lines, i=i: dtest.expect_event_sequence(lines, [
+            '^x%d: type tmpfs$' % i, '^x%d: files 1$' % i, '^x%d: full$' % i]))
+try:
+    dtest.run()
+finally:
+    os.chdir('/')
+    os.rmdir(workdir)
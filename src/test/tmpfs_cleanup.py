@@ -0,0 +1,18 @@
+import os
+import sys
+import dtest
+
+# the mount point that does not exist is created and removed by dtest
+path = '/tmp/dtest-tmpfs-cleanup-%d' % os.getpid()
+dtest.cluster(name="x",size=2)
+dtest.exit_code("all")
+dtest.tmpfs(path)
+dtest.add_process([0,1], ["sh", "-c", 'stat -f -c "type %%T" %s' % path])
+for i in (1,2):
+    dtest.add_test('node %d has tmpfs' % i,
+        lambda lines, i=i: dtest.expect_event_count(lines, '^x%d: type tmpfs$' % i, 1))
+ret = dtest.run()
+if os.path.exists(path):
+    os.rmdir(path)
+    sys.exit('%s is not removed' % path)
+sys.exit(ret)
@@ -0,0 +1,73 @@
+import os
+import struct
+import sys
+import tempfile
+import dtest
+
+def test_traffic(lines):
+    dtest.expect_event_count(lines, '^x1: done$', 1)
+    sender = dtest.traffic(node=0)
+    receiver = dtest.traffic(node=1)
+    total = dtest.traffic()
+    assert sender['packets_sent'] >= 10, sender
+    assert sender['bytes_sent'] >= 10*100, sender
+    assert receiver['packets_received'] >= 10, receiver
+    assert total['packets_sent'] >= sender['packets_sent'] + receiver['packets_sent'], total
+
+def check_capture(filename):
+    with open(filename, 'rb') as f:
+        data = f.read()
+    blocks = []
+    offset = 0
+    while offset < len(data):
+        block_type, size = struct.unpack_from('=II', data, offset)
+        if size < 12 or size % 4 != 0 or offset + size > len(data) or \
+           struct.unpack_from('=I', data, offset + size - 4)[0] != size:
+            raise ValueError('bad block at offset %d' % offset)
+        blocks.append((block_type, data[offset+8:offset+size-4]))
+        offset += size
+    # section header block: byte order magic and version 1.0
+    block_type, body = blocks[0]
+    if block_type != 0x0A0D0D0A or struct.unpack_from('=IHH', body) != (0x1A2B3C4D, 1, 0):
+        raise ValueError('bad section header block')
+    # interface description block: Ethernet link type
+    block_type, body = blocks[1]
+    if block_type != 1 or struct.unpack_from('=H', body)[0] != 1:
+        raise ValueError('bad interface description block')
+    comments = []
+    for block_type, body in blocks[2:]:
+        if block_type != 6: raise ValueError('unexpected block type %d' % block_type)
+        interface, high, low, captured, length = struct.unpack_from('=IIIII', body)
+        if interface != 0 or captured > length: raise ValueError('bad enhanced packet block')
+        offset = 20 + captured + (4 - captured % 4) % 4
+        while offset < len(body):
+            code, size = struct.unpack_from('=HH', body, offset)
+            if code == 0: break
+            if code == 1: comments.append(body[offset+4:offset+4+size].decode())
+            offset += 4 + size + (4 - size % 4) % 4
+    if comments.count('x1 -> x2') < 10:
+        raise ValueError('too few datagrams from x1 to x2 in %r' % comments)
+
+# send ten datagrams from the first node to the second one
+script = '''
+import os, socket
+address = os.environ['DTEST_INTERFACE_ADDRESS'].split('/')[0].split('.')
+address[3] = str(int(address[3])+1)
+s = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+for i in range(10): s.sendto(b'x'*100, ('.'.join(address), 9))
+'''
+dtest.cluster(name="x",size=2)
+dtest.exit_code("all")
+filename = os.path.join(tempfile.gettempdir(), 'dtest-traffic-%d.pcapng' % os.getpid())
+dtest.capture(filename)
+dtest.add_process([0], ["sh", "-c", "python3 -c \"$0\"; sleep 1; echo done", script])
+dtest.add_process([1], ["sleep", "2"])
+dtest.add_test('traffic', test_traffic)
+ret = dtest.run()
+try:
+    check_capture(filename)
+except Exception as err:
+    sys.exit('bad capture: %s' % err)
+finally:
+    if os.path.exists(filename): os.remove(filename)
+sys.exit(ret)
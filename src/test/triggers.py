@@ -0,0 +1,35 @@
+import dtest
+
+# the number of evaluations before the trigger line was captured
+early_evaluations = {}
+
+def evaluated_after_trigger(trigger_line):
+    def test(lines):
+        if any(str(line) == trigger_line for line in lines):
+            n = early_evaluations.get(trigger_line, 0)
+            if n > 1: raise ValueError('%s: %d evaluations before the trigger' % (trigger_line, n))
+            return
+        # the test is evaluated once when it becomes the first in the queue,
+        # after that only the lines that match the trigger start the evaluation
+        early_evaluations[trigger_line] = early_evaluations.get(trigger_line, 0) + 1
+        raise ValueError('%s is not captured yet' % trigger_line)
+    return test
+
+ticks = 'for i in 1 2 3 4 5; do echo "tick $i"; sleep 0.1; done'
+dtest.cluster(name="x",size=2)
+dtest.exit_code("all")
+dtest.timeout(30)
+dtest.add_process([0,1], ["sh", "-c", "seq 1000; echo done"])
+dtest.add_process([0], ["sh", "-c", ticks + "; sleep 0.5; echo late"])
+dtest.add_process([1], ["sh", "-c", ticks + "; echo 'not go'; sleep 0.5; echo go"])
+dtest.add_test('done on node 1',
+               lambda lines: dtest.expect_event_sequence(lines, ['^x1: done$']),
+               triggers=['^x1: done$'])
+dtest.add_test('done on node 2',
+               lambda lines: dtest.expect_event_sequence(lines, ['^x2: done$']),
+               triggers=['^x2: done$'])
+dtest.add_test('late trigger line starts the evaluation',
+               evaluated_after_trigger('x1: late'), triggers=['^x1: late$'])
+dtest.add_test('non-matching lines do not start the evaluation',
+               evaluated_after_trigger('x2: go'), triggers=['^x2: go$'])
+dtest.run()
@@ -0,0 +1,30 @@
+import os
+import sys
+import dtest
+
+# splice(2) fails for the output opened in append mode,
+# hence dtest falls back to the ordinary copy in the middle of the line
+output = os.environ.get('DTEST_ZERO_COPY_OUTPUT')
+if output:
+    fd = os.open(output, os.O_WRONLY | os.O_CREAT | os.O_TRUNC | os.O_APPEND)
+    os.dup2(fd, 1)
+    os.close(fd)
+
+dtest.cluster(name="x",size=2)
+dtest.exit_code("all")
+dtest.zero_copy(True)
+dtest.add_process([0,1], ["sh", "-c", "printf par; sleep 1; printf 'tial\\n'; echo done; echo error >&2"])
+for i in (1,2):
+    dtest.add_test('node %d output is captured' % i,
+        lambda lines, i=i: dtest.expect_event_sequence(lines, [
+            '^x%d: partial$' % i, '^x%d: done$' % i]))
+    dtest.add_test('node %d error is captured' % i,
+        lambda lines, i=i: dtest.expect_event_count(lines, '^x%d: error$' % i, 1))
+dtest.run()
+if output:
+    with open(output) as f:
+        forwarded = f.read()
+    # both processes' output is forwarded exactly once
+    if forwarded.count('par') != 2 or forwarded.count('tial') != 2 or forwarded.count('done') != 2:
+        sys.stderr.write('bad forwarded output: %r\n' % forwarded)
+        sys.exit(1)